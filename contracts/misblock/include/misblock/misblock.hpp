@@ -31,6 +31,13 @@ namespace misblock {
     using namespace std;
     using namespace eosio;
 
+    // 보상 주기(초), TEST 빌드에서는 1분마다 보상
+    #ifdef TEST
+    static constexpr uint32_t rewardsPeriodSeconds = common::secondsPerMinute;
+    #else
+    static constexpr uint32_t rewardsPeriodSeconds = common::secondsPerMonth;
+    #endif
+
     // 임시 테스트 테이블
     struct [[eosio::table, eosio::contract("misblock")]] TestPubInfo {
         uuidType    id;
@@ -51,8 +58,89 @@ namespace misblock {
         time_point  lastRewardsUpdate;
     };
 
-    struct [[eosio::table, eosio::contract("misblock")]] HospitalInfo {
+    // 기존 배포의 config row를 그대로 읽을 수 있도록 추가 설정은 별도의 singleton에 보관
+    struct [[eosio::table("configext"), eosio::contract("misblock")]] ConfigExtInfo {
+        // 이 기간(초)보다 오래된 후기는 prune 대상
+        uint32_t    reviewRetention = common::secondsPerYear;
+
+        // false 이면 후기 제목을 저장하지 않고 contentHash만 남김 (본문은 오프체인 저장소에서 제공)
+        bool        storeTitle = true;
+
+        // 오프체인 순위 제출(proposerank) 설정, 기본 지역만 대상이고 지역 순위는 giverewards( region )이 직접 계산
+        name        rankWorker;
+        // 제출한 보상 기간 안에 끝나야 finalrank에서 지급되므로 보상 주기보다 충분히 짧게 (TEST 빌드에서는 15초)
+        uint32_t    rankChallengeWindow = std::min( common::secondsPerDay, rewardsPeriodSeconds / 4 );
+        // threshold 이상인 row의 수를 쓰기 경로에서 증분 관리하여 제출된 순위의 완전성을 O(K)로 검증
+        double      hospitalThreshold = 1;
+        int32_t     reviewThreshold = 100;
+        uint32_t    hospitalsAbove = 0;
+        uint32_t    reviewsAbove = 0;
+        // 마지막으로 제출된 순위의 id, 현재 challenge 중인 순위의 id (없으면 0)
+        uint64_t    rankProposalSeq = 0;
+        uint64_t    openRankProposal = 0;
+
+        // 적립 후 pointExpiry 달이 지난 포인트는 소멸, 접근할 때 지연 처리
+        uint32_t    pointExpiry = 12;
+        pointType   expiredPointSupply = 0;
+
+        // addemrsales를 호출할 수 있는 EMR 마켓 계정
+        name        emrReporter;
+
+        // 마지막으로 연 결제 채널의 nonce
+        uint64_t    channelSeq = 0;
+
+        // audit 진행 상태, 0: 대기, 1: 고객 포인트 합계, 2: 병원 별 후기 수 (기본 지역부터 regions 순서대로)
+        uint8_t     auditPhase = 0;
+        uint64_t    auditCursor = 0;        // 다음에 검사할 primary key (phase 2에서는 현재 병원)
+        uint64_t    auditSubCursor = 0;     // phase 2에서 현재 병원의 다음 reviewId
+        name        auditRegion;            // phase 2에서 현재 검사 중인 지역
+        uint32_t    auditMonth = 0;
+        pointType   auditPointSum = 0;
+        uint32_t    auditReviewSum = 0;
+
+        // 일 단위 통계(rollups) 보관 기간과 아직 정리하지 않은 가장 오래된 날
+        uint32_t    rollupRetention = 90;
+        uint32_t    rollupPurgeDay = 0;
+
+        // 결제 후 후기를 작성할 수 있는 기간(초)
+        uint32_t    entitlementTTL = 3 * common::secondsPerMonth;
+
+        // migrate 진행 상태, 0: 완료, 1: 고객, 2: 후기, 3: 순위 카운터
+        uint8_t     migrationPhase = 0;
+        uint64_t    migrationCursor = 0;
+    };
+
+    struct [[eosio::table("rankprop"), eosio::contract("misblock")]] RankProposal {
+        uint64_t            id;
+        name                proposer;
+        vector<name>        hospitals;
+        vector<uuidType>    reviews;
+        time_point          challengeEnd;
+        uint32_t            period;         // 제출한 보상 기간, 이 기간이 지나면 finalrank에서 폐기
+        // 제출 시점의 마지막 항목의 값, challenge는 이 값과 비교
+        double              lastWeight;
+        int32_t             lastLikes;
+    };
+
+    struct [[eosio::table, eosio::contract("misblock")]] RankSnapshotInfo {
         // scope: code, ram payer: misblock
+        // 순위가 제출된 후 처음 바뀐 병원/후기의 제출 시점 값, 다른 제출의 row는 쓰기 때마다 조금씩 정리
+        uint64_t    id;
+        uint64_t    proposal;   // RankProposal::id
+        uint64_t    key;        // 병원: owner.value, 후기: id
+        bool        isReview;
+        double      value;      // 병원: serviceWeight, 후기: likes
+
+        uint64_t  primary_key() const { return id; }
+        uint128_t byKey()       const { return keyOf( proposal, key, isReview ); }
+
+        static uint128_t keyOf( const uint64_t& proposal, const uint64_t& key, const bool& isReview ) {
+            return ( uint128_t( key ) << 64 ) | ( proposal << 1 ) | isReview;
+        }
+    };
+
+    struct [[eosio::table, eosio::contract("misblock")]] HospitalInfo {
+        // scope: region (기본 지역은 code), ram payer: misblock
         name        owner;
         string      url;
 
@@ -67,6 +155,9 @@ namespace misblock {
         uint32_t    reviewVisitors = 0;
         uint32_t    totalReviewsLike = 0;
 
+        // "" 이면 기본 지역, 이전 버전의 row에는 없고 모두 기본 지역
+        binary_extension<name>  region;
+
         uint64_t    primary_key() const { return owner.value; }
         double      byWeight()    const { return -serviceWeight; }
 
@@ -79,6 +170,7 @@ namespace misblock {
         uint8_t         tier;
         pointType       point;
 
+        // 후기 작성 자격이 있는 병원, 만료 시각은 entitlements 테이블에 있음
         set<name>       hospitals;
 
         // 현재 시간을 day로 나눠서 lastLikeTime 보다 크다면 하루가 지난것을 의미하기 때문에 하루에 세번 like 할 수 있도록 할 수 있다.
@@ -86,30 +178,53 @@ namespace misblock {
         uint8_t         remainLike = 3;
         time_point      lastLikeTime;
 
+        // 적립된 달 별 포인트, 오래된 순서, 합계는 point와 같다
+        // 이전 버전의 row에는 없음, 다음 적립/차감이나 migrate에서 현재 달로 채움
+        binary_extension< vector<pointBucket> > buckets;
+
         uint64_t primary_key() const { return owner.value; }
 
-        void setTier() {
+        void setTier() { tier = tierOf( point ); }
+
+        static uint8_t tierOf( const pointType& point ) {
             switch ( point ) {
             case 0 ... 4999999:
-                tier = BABY;
-                break;
+                return BABY;
             case 5000000 ... 14999999:
-                tier = BRONZE;
-                break;
+                return BRONZE;
             case 15000000 ... 24999999:
-                tier = SILVER;
-                break;
+                return SILVER;
             case 25000000 ... 34999999:
-                tier = GOLD;
-                break;
+                return GOLD;
             case 35000000 ... 49999999:
-                tier = PLATINUM;
-                break;
+                return PLATINUM;
             default:
-                tier = DIAMOND;
-                break;
+                return DIAMOND;
             }
         }
+
+        // month 기준으로 소멸되지 않은 포인트, row를 수정하지 않고 조회할 때 사용
+        pointType livePoint( const uint32_t& month, const uint32_t& expiry ) const {
+            pointType live = point;
+            if ( !buckets.has_value() ) return live;
+            for ( const auto& b : *buckets ) {
+                if ( b.month + expiry > month ) break;
+                live -= b.amount;
+            }
+            return live;
+        }
+        uint8_t   liveTier( const uint32_t& month, const uint32_t& expiry ) const { return tierOf( livePoint( month, expiry ) ); }
+
+        // 소멸된 bucket을 제거하고 소멸된 포인트를 반환
+        pointType expirePoints( const uint32_t& month, const uint32_t& expiry ) {
+            pointType expired = 0;
+            if ( !buckets.has_value() ) return expired;
+            auto it = buckets->begin();
+            for ( ; it != buckets->end() && it->month + expiry <= month; ++it ) expired += it->amount;
+            buckets->erase( buckets->begin(), it );
+            point -= expired;
+            return expired;
+        }
     };
 
     struct [[eosio::table, eosio::contract("misblock")]] ReviewInfo {
@@ -124,30 +239,214 @@ namespace misblock {
         int32_t     likes = 0; // 컨트랙트 내에서 처리해야 할까? 일별로 3개의 좋아요를 할 수 있는 제한을 구현하기가 애매하다. 시간으로?
 
         string      title;
+
+        // 이전 버전의 row에는 없음, migrate에서 채움
+        binary_extension<time_point>    postedAt;
+        // sha256( pack( title, reviewJson ) ), migrate된 row는 본문이 없으므로 0
+        binary_extension<checksum256>   contentHash;
+        // 병원의 지역, 지역 별 순위에 사용, migrate에서 채움
+        binary_extension<name>          region;
         
         uint64_t primary_key()  const { return id; }
         bool     Expired()      const { return isExpired; }
         uint64_t byOwner()      const { return owner.value; }
         uint64_t byHospital()   const { return hospital.value; }
+        // 만료된 후기가 가장 앞에, 그 뒤로 오래된 순서대로 정렬
+        uint64_t byStale()      const { return isExpired ? 0 : postedAt.value_or().sec_since_epoch(); }
+        checksum256 byHash()    const { return contentHash.value_or(); }
+        uint128_t   byHospitalId() const { return ( uint128_t( hospital.value ) << 64 ) | id; }
+        // 지역 별로 좋아요 내림차순, 만료된 후기는 지역의 맨 뒤
+        uint128_t   byRegionLike() const { return ( uint128_t( region.value_or().value ) << 64 ) | ( isExpired ? UINT64_MAX : uint64_t( INT32_MAX - likes ) ); }
+    };
+
+    // 이전 버전의 reviews row와 인덱스, migrate에서 예전 bylike 인덱스 항목까지 지우는 데만 사용
+    struct LegacyReviewInfo {
+        uuidType    id;
+        name        owner;
+        name        hospital;
+        set<name>   likers;
+        bool        isExpired = 0;
+        int32_t     likes = 0;
+        string      title;
+
+        uint64_t primary_key()  const { return id; }
+        uint64_t byOwner()      const { return owner.value; }
         double   byWeight()     const { return isExpired ? (double)likes : -(double)likes; }
     };
 
+    struct [[eosio::table, eosio::contract("misblock")]] ArchivedReviewInfo {
+        // scope: code, ram payer: misblock
+        // prune된 후기의 고정 크기 요약본
+        uuidType    id;
+        name        owner;
+        name        hospital;
+        int32_t     likes = 0;
+        checksum256 contentHash;
+
+        uint64_t primary_key()  const { return id; }
+        uint64_t byOwner()      const { return owner.value; }
+    };
+
+    struct [[eosio::table, eosio::contract("misblock")]] CashDepositInfo {
+        // scope: code, ram payer: misblock
+        // 병원이 settlecash로 일괄 정산하기 위해 미리 입금한 MIS
+        name        hospital;
+        asset       balance;
+
+        uint64_t primary_key() const { return hospital.value; }
+    };
+
+    struct [[eosio::table, eosio::contract("misblock")]] PointVintageInfo {
+        // scope: code, ram payer: misblock
+        // 달 별로 아직 소멸되지 않은 전체 포인트, totalPointSupply를 전체 스캔 없이 맞추기 위해 사용
+        uint64_t    month;
+        pointType   amount = 0;
+
+        uint64_t primary_key() const { return month; }
+    };
+
+    struct [[eosio::table, eosio::contract("misblock")]] EmrWindowInfo {
+        // scope: code, ram payer: misblock
+        // window 별로 마지막으로 반영한 병원과 반영한 청크의 hash, 같은 청크를 다시 보내도 중복 반영되지 않음
+        uint64_t            windowStart;
+        name                lastHospital;
+        vector<checksum256> chunks;     // sha256( pack( sales ) )
+
+        uint64_t primary_key() const { return windowStart; }
+    };
+
+    struct [[eosio::table, eosio::contract("misblock")]] ChannelInfo {
+        // scope: code, ram payer: customer
+        // 원격상담 결제 채널, 고객이 MIS를 예치하고 상담 중에는 오프체인 voucher에 서명
+        uuidType    id;
+        name        customer;
+        name        hospital;
+        public_key  customerKey;
+        asset       deposit;
+        time_point  expiresAt;
+        uint64_t    nonce;      // 채널마다 다른 값, voucher에 포함
+
+        uint64_t primary_key() const { return id; }
+    };
+
+    struct [[eosio::table, eosio::contract("misblock")]] RelayKeyInfo {
+        // scope: code, ram payer: misblock
+        // relaylikes로 대신 제출되는 좋아요를 검증하기 위한 고객의 공개키와 마지막 nonce
+        name        owner;
+        public_key  likeKey;
+        uint64_t    nonce = 0;
+
+        uint64_t primary_key() const { return owner.value; }
+    };
+
+    struct [[eosio::table, eosio::contract("misblock")]] AuditLogInfo {
+        // scope: code, ram payer: misblock
+        // audit가 발견한 불일치, [fromKey, toKey] 범위의 row가 원인
+        uint64_t    id;
+        uint8_t     kind;
+        uint64_t    fromKey;
+        uint64_t    toKey;
+        int64_t     expected;
+        int64_t     actual;
+        time_point  foundAt;
+
+        uint64_t primary_key() const { return id; }
+    };
+
+    struct [[eosio::table, eosio::contract("misblock")]] RollupInfo {
+        // scope: day (sec_since_epoch / secondsPerDay), ram payer: misblock
+        // 병원과 무관한 통계(포인트 발행, MIS 교환)는 hospital = ""
+        name        hospital;
+        uint32_t    likes = 0;
+        uint32_t    posts = 0;
+        uint32_t    payments = 0;
+        int64_t     paidAmount = 0;
+        pointType   pointsIssued = 0;
+        int64_t     misExchanged = 0;
+
+        uint64_t primary_key() const { return hospital.value; }
+    };
+
+    struct [[eosio::table, eosio::contract("misblock")]] RegionInfo {
+        // scope: code, ram payer: misblock
+        // 지역 목록, 각 지역의 병원은 region 이름을 scope로 하는 hospitals 테이블에 있음
+        name        region;
+        asset       monthlyReward;      // 지역 상위 병원 하나에 매달 지급하는 보상
+        asset       rewardPool;         // 남은 지역 보상 예산, 지급할 때마다 차감
+        uint32_t    hospitalCount = 0;
+        time_point  lastRewardsUpdate;
+
+        uint64_t primary_key() const { return region.value; }
+    };
+
+    struct [[eosio::table, eosio::contract("misblock")]] HospitalRegionInfo {
+        // scope: code, ram payer: misblock
+        // 기본 지역이 아닌 병원의 지역
+        name        hospital;
+        name        region;
+
+        uint64_t primary_key() const { return hospital.value; }
+    };
+
+    struct [[eosio::table, eosio::contract("misblock")]] EntitlementInfo {
+        // scope: code, ram payer: misblock
+        // 후기 작성 자격의 만료 큐, byexpiry 순서로 만료된 것부터 정리
+        uint64_t    id;
+        name        customer;
+        name        hospital;
+        time_point  expiresAt;
+
+        uint64_t  primary_key() const { return id; }
+        uint128_t byPair()      const { return ( uint128_t( customer.value ) << 64 ) | hospital.value; }
+        uint64_t  byExpiry()    const { return expiresAt.sec_since_epoch(); }
+    };
+
     typedef eosio::singleton< name("config"), ConfigInfo > configSingleton;
+    typedef eosio::singleton< name("configext"), ConfigExtInfo > configextSingleton;
+    typedef eosio::singleton< name("rankprop"), RankProposal > rankpropSingleton;
 
     typedef eosio::multi_index< name("hospitals"), HospitalInfo,
                                 indexed_by< name("byservice"), const_mem_fun< HospitalInfo, double, &HospitalInfo::byWeight > >
                                 > hospitalsTable;
     typedef eosio::multi_index< name("customers"), CustomerInfo > customersTable;
+    typedef eosio::multi_index< name("cashdeposit"), CashDepositInfo > cashdepositTable;
+    typedef eosio::multi_index< name("vintages"), PointVintageInfo > vintagesTable;
+    typedef eosio::multi_index< name("emrwindows"), EmrWindowInfo > emrwindowsTable;
+    typedef eosio::multi_index< name("channels"), ChannelInfo > channelsTable;
+    typedef eosio::multi_index< name("relaykeys"), RelayKeyInfo > relaykeysTable;
+    typedef eosio::multi_index< name("auditlog"), AuditLogInfo > auditlogTable;
+    typedef eosio::multi_index< name("rollups"), RollupInfo > rollupsTable;
+    typedef eosio::multi_index< name("regions"), RegionInfo > regionsTable;
+    typedef eosio::multi_index< name("hospdir"), HospitalRegionInfo > hospdirTable;
+    typedef eosio::multi_index< name("ranksnaps"), RankSnapshotInfo,
+                                indexed_by< name("bykey"), const_mem_fun< RankSnapshotInfo, uint128_t, &RankSnapshotInfo::byKey > >
+                                > ranksnapsTable;
+    typedef eosio::multi_index< name("entitlement"), EntitlementInfo,
+                                indexed_by< name("bypair"), const_mem_fun< EntitlementInfo, uint128_t, &EntitlementInfo::byPair > >,
+                                indexed_by< name("byexpiry"), const_mem_fun< EntitlementInfo, uint64_t, &EntitlementInfo::byExpiry > >
+                                > entitlementTable;
     typedef eosio::multi_index< name("reviews"), ReviewInfo,
                                 indexed_by< name("byowner"), const_mem_fun< ReviewInfo, uint64_t, &ReviewInfo::byOwner > >,
-                                indexed_by< name("bylike"), const_mem_fun< ReviewInfo, double, &ReviewInfo::byWeight > >
+                                indexed_by< name("bystale"), const_mem_fun< ReviewInfo, uint64_t, &ReviewInfo::byStale > >,
+                                indexed_by< name("byhash"), const_mem_fun< ReviewInfo, checksum256, &ReviewInfo::byHash > >,
+                                indexed_by< name("byhospital"), const_mem_fun< ReviewInfo, uint128_t, &ReviewInfo::byHospitalId > >,
+                                indexed_by< name("byregion"), const_mem_fun< ReviewInfo, uint128_t, &ReviewInfo::byRegionLike > >
                                 > reviewsTable;
+    typedef eosio::multi_index< name("reviews"), LegacyReviewInfo,
+                                indexed_by< name("byowner"), const_mem_fun< LegacyReviewInfo, uint64_t, &LegacyReviewInfo::byOwner > >,
+                                indexed_by< name("bylike"), const_mem_fun< LegacyReviewInfo, double, &LegacyReviewInfo::byWeight > >
+                                > legacyReviewsTable;
+    typedef eosio::multi_index< name("archives"), ArchivedReviewInfo,
+                                indexed_by< name("byowner"), const_mem_fun< ArchivedReviewInfo, uint64_t, &ArchivedReviewInfo::byOwner > >
+                                > archivesTable;
 
     class [[eosio::contract("misblock")]] misblock : public eosio::contract {
         private:
-            configSingleton _config;
+            configSingleton     _config;
+            configextSingleton  _configext;
 
             ConfigInfo      _cstate;
+            ConfigExtInfo   _cext;
 
             ConfigInfo      getDefaultConfig() {
                 return ConfigInfo{
@@ -163,16 +462,61 @@ namespace misblock {
             void transferEventHandler( uint64_t sender, uint64_t receiver, T func );
             void paybillmis( const name& customer, const name& hospital, const asset& cost, const uuidType& reviewId = nullID );
             void paybillcash( const name& customer, const name& hospital, const asset& cost, const uuidType& reviewId = nullID );
+            void depositcash( const name& hospital, const asset& quantity );
+            void payconsmis( const name& customer, const uuidType& channelId, const asset& quantity );
             void addPoint( const name& owner, const pointType& point );
             void subPoint( const name& owner, const pointType& point );
+            void creditPoint( CustomerInfo& c, const pointType& point );
+            uint32_t currentMonth() const { return currentTimePoint().sec_since_epoch() / common::secondsPerMonth; }
+            void rollVintages();
+            void updateVintage( const uint32_t& month, const int64_t& delta );
+            void seedBuckets( CustomerInfo& c, const uint32_t& month );
+
+            void checkRewardsPeriod( const time_point& ct, const time_point& lastRewardsUpdate );
+            uint32_t rewardsPeriod( const time_point& t ) const;
+            void payRewards( const name& region, const asset& reward, const vector<name>& hospitals, const vector<uuidType>& reviews );
+            // 기본 지역("")의 병원은 code scope에 있음
+            uint64_t scopeOf( const name& region ) const { return region == name() ? get_self().value : region.value; }
+            name     regionOf( const name& hospital );
+            // serviceWeight 또는 review 순위 조건이 바뀔 때 threshold 카운터를 함께 갱신 (기본 지역만)
+            void updateWeight( HospitalInfo& h );
+            bool isRanked( const ReviewInfo& r ) const { return r.region.value_or() == name() && !r.isExpired && r.likes >= _cext.reviewThreshold; }
+            void updateRanked( const bool& before, const bool& after );
+            void recountRanked();
+            // challenge 중에 바뀌는 row의 제출 시점 값을 기록하고 조회
+            void   snapshotRank( const uint64_t& key, const bool& isReview, const double& value );
+            double rankValueAt( const uint64_t& proposal, const uint64_t& key, const bool& isReview, const double& current );
+            // 이전 버전에서 업그레이드한 후 migrate가 끝나기 전에는 새 인덱스에 없는 후기가 남아 있음
+            void checkMigrated() const { check( _cext.migrationPhase == 0, "migration is in progress, run migrate first" ); }
+            void useLikes( CustomerInfo& c, const time_point& ct, const uint8_t& count );
+            // audit가 이미 지나간 row가 바뀌면 부분합을 함께 보정
+            void auditPoint( const name& owner, const int64_t& delta );
+            void auditReview( const name& hospital, const uuidType& reviewId, const int32_t& delta );
+            template<typename F>
+            void bumpRollup( const name& hospital, F update );
+            void purgeRollups( const uint32_t& today, uint32_t limit );
+            // 후기 작성 자격 부여/회수, 만료된 자격은 popEntitlements로 limit개 씩 정리
+            void grantEntitlement( const name& customer, const name& hospital );
+            void revokeEntitlement( const name& customer, const name& hospital );
+            // hospitals에 있으나 자격 row가 없는 병원에 자격 부여 (migrate, loadcustomr)
+            void backfillEntitlements( const CustomerInfo& customer );
+            void popEntitlements( uint32_t limit );
+            void auditMismatch( const uint8_t& kind, const uint64_t& fromKey, const uint64_t& toKey, const int64_t& expected, const int64_t& actual );
 
         public:
             misblock( name receiver, name code, datastream<const char*> ds )
-                : contract( receiver, code, ds ), _config( receiver, receiver.value ) {
+                : contract( receiver, code, ds ), _config( receiver, receiver.value ), _configext( receiver, receiver.value ) {
                     _cstate = _config.exists() ? _config.get() : getDefaultConfig();
+                    if ( _configext.exists() ) {
+                        _cext = _configext.get();
+                    } else if ( _config.exists() ) {
+                        // 이전 버전에서 업그레이드, migrate가 끝날 때까지 후기/순위 관련 action은 막힘
+                        _cext.migrationPhase = 1;
+                    }
                 }
             ~misblock() {
                 _config.set( _cstate, get_self() );
+                _configext.set( _cext, get_self() );
             }
 
             // test용
@@ -191,6 +535,15 @@ namespace misblock {
             [[eosio::action]]
             void setlikerwd( const pointType& likeReward );
 
+            [[eosio::action]]
+            void setretention( const uint32_t& reviewRetention );
+
+            [[eosio::action]]
+            void settitlemode( const bool& storeTitle );
+
+            [[eosio::action]]
+            void setptexpiry( const uint32_t& pointExpiry );
+
             [[eosio::action]]
             void givepoint( const name& owner, const pointType& point, const string& memo );
 
@@ -198,10 +551,35 @@ namespace misblock {
             void burnpoint( const name& owner, const pointType& point, const string& memo );
 
             [[eosio::action]]
-            void giverewards();
+            void giverewards( const name& region );
+
+            [[eosio::action]]
+            void setregion( const name& region, const asset& monthlyReward, const asset& rewardPool );
+
+            [[eosio::action]]
+            void setrankcfg( const name& rankWorker, const uint32_t& rankChallengeWindow, const double& hospitalThreshold, const int32_t& reviewThreshold );
+
+            // 기본 지역 전용, 지역 병원이나 후기를 넣으면 실패
+            [[eosio::action]]
+            void proposerank( const vector<name>& hospitals, const vector<uuidType>& reviews );
+
+            [[eosio::action]]
+            void challenge( const name& challenger, const uint64_t& key, const bool& isReview );
+
+            [[eosio::action]]
+            void finalrank();
+
+            [[eosio::action]]
+            void cancelrank();
+
+            [[eosio::action]]
+            void setemrrptr( const name& emrReporter );
+
+            [[eosio::action]]
+            void addemrsales( const uint64_t& windowStart, const vector<emrSale>& sales );
 
             [[eosio::action]]
-            void reghospital( const name& owner, const string& url );
+            void reghospital( const name& owner, const string& url, const name& region );
 
             [[eosio::action]]
             void exchangemis( const name& owner, const pointType& point );
@@ -213,6 +591,64 @@ namespace misblock {
             [[eosio::action]]
             void like( const name& owner, const uint64_t& reviewId );
 
+            [[eosio::action]]
+            void prune( const uint32_t& limit, const bool& archive );
+
+            [[eosio::action]]
+            void settlecash( const name& hospital, const vector<cashReceipt>& receipts );
+
+            // 정산하고 남은 cashdeposit 잔액을 병원이 돌려받음, 잔액이 0이 되면 row 삭제
+            [[eosio::action]]
+            void withdrawcash( const name& hospital, const asset& quantity );
+
+            // snapshot.sh로 덤프한 청크를 그대로 적재 (primary key 오름차순)
+            // entitlement 테이블은 덤프하지 않으므로 고객의 hospitals에 대해 적재 시점부터 자격을 다시 부여
+            [[eosio::action]]
+            void loadcustomr( const vector<customerRow>& rows );
+
+            [[eosio::action]]
+            void loadhospital( const vector<hospitalRow>& rows );
+
+            [[eosio::action]]
+            void loadreviews( const vector<reviewRow>& rows );
+
+            [[eosio::action]]
+            void openchannel( const name& customer, const name& hospital, const uuidType& channelId, const public_key& customerKey, const uint32_t& timeout );
+
+            // voucher: sha256( pack( misblock, channelId, customer, hospital, nonce, amount ) )에 대한 고객의 서명, nonce는 channels 테이블에서 조회
+            [[eosio::action]]
+            void settlechan( const name& hospital, const uuidType& channelId, const asset& amount, const signature& sig );
+
+            [[eosio::action]]
+            void refundchan( const name& customer, const uuidType& channelId );
+
+            [[eosio::action]]
+            void setlikekey( const name& owner, const public_key& likeKey );
+
+            [[eosio::action]]
+            void relaylikes( const name& relayer, const vector<likeIntent>& likes );
+
+            [[eosio::action]]
+            void audit( const uint32_t& limit );
+
+            [[eosio::action]]
+            void setrollupret( const uint32_t& rollupRetention );
+
+            // 대시보드 조회용, [fromDay, toDay] 범위의 통계를 출력
+            [[eosio::action]]
+            void getrollups( const name& hospital, const uint32_t& fromDay, const uint32_t& toDay );
+
+            [[eosio::action]]
+            void setentttl( const uint32_t& entitlementTTL );
+
+            [[eosio::action]]
+            void expireents( const uint32_t& limit );
+
+            // 이전 버전의 테이블이 있는 계정에 배포한 후 "migration completed"가 출력될 때까지 반복 호출
+            // 끝나기 전에는 postreview, like, relaylikes, prune, audit, giverewards, proposerank, finalrank가 실패함
+            [[eosio::action]]
+            void migrate( const uint32_t& limit );
+
             [[eosio::action]]
             void transferevnt( const uint64_t& sender, const uint64_t& receiver );
 
@@ -25,10 +25,29 @@ namespace misblock {
         eosio::printl( "cleaning", 8 );
 
         _cstate = getDefaultConfig();
+        _cext   = ConfigExtInfo();
 
         cleanTable<hospitalsTable>( get_self(), get_self().value );
+        regionsTable regiontable( get_self(), get_self().value );
+        for ( const auto& g : regiontable ) {
+            cleanTable<hospitalsTable>( get_self(), g.region.value );
+        }
+        cleanTable<regionsTable>( get_self(), get_self().value );
+        cleanTable<hospdirTable>( get_self(), get_self().value );
         cleanTable<customersTable>( get_self(), get_self().value );
         cleanTable<reviewsTable>( get_self(), get_self().value );
+        cleanTable<archivesTable>( get_self(), get_self().value );
+        cleanTable<cashdepositTable>( get_self(), get_self().value );
+        cleanTable<vintagesTable>( get_self(), get_self().value );
+        cleanTable<emrwindowsTable>( get_self(), get_self().value );
+        cleanTable<channelsTable>( get_self(), get_self().value );
+        cleanTable<relaykeysTable>( get_self(), get_self().value );
+        cleanTable<auditlogTable>( get_self(), get_self().value );
+        cleanTable<entitlementTable>( get_self(), get_self().value );
+        cleanTable<ranksnapsTable>( get_self(), get_self().value );
+
+        rankpropSingleton rankprop( get_self(), get_self().value );
+        if ( rankprop.exists() ) rankprop.remove();
     }
 
     void misblock::signup( const name& owner ) {
@@ -69,6 +88,25 @@ namespace misblock {
         _cstate.likeReward = likeReward;
     }
 
+    void misblock::setretention( const uint32_t& reviewRetention ) {
+        require_auth( get_self() );
+        check( reviewRetention >= common::secondsPerDay, "retention must be at least one day" );
+        _cext.reviewRetention = reviewRetention;
+    }
+
+    void misblock::settitlemode( const bool& storeTitle ) {
+        require_auth( get_self() );
+        _cext.storeTitle = storeTitle;
+    }
+
+    void misblock::setptexpiry( const uint32_t& pointExpiry ) {
+        require_auth( get_self() );
+        check( pointExpiry > 0, "must set positive value" );
+        // 이미 소멸 처리된 달은 되돌릴 수 없으므로 소멸이 시작된 후에는 기간을 늘릴 수 없음
+        check( pointExpiry <= _cext.pointExpiry || _cext.expiredPointSupply == 0, "cannot extend expiry after points have expired" );
+        _cext.pointExpiry = pointExpiry;
+    }
+
     void misblock::givepoint( const name& owner, const types::pointType& point, const string& memo ) {
         require_auth( get_self() );
         check( point > 0, "must set positive point" );
@@ -83,74 +121,347 @@ namespace misblock {
         subPoint( owner, point );
     }
 
-    void misblock::giverewards() {
-        // misblock이 매달 상위 16개의 병원에게 100만 MIS 토큰을 보상함
+    void misblock::giverewards( const name& region ) {
+        // misblock이 매달 지역 별 상위 16개의 병원에게 병원 당 monthlyReward 만큼 MIS 토큰을 보상함 (기본 지역은 100만 MIS)
         require_auth( get_self() );
+        checkMigrated();
+
+        regionsTable regiontable( get_self(), get_self().value );
+        auto gitr = regiontable.find( region.value );
+        check( region == name() || gitr != regiontable.end(), "region does not exist" );
+
+        // 기본 지역은 제출된 순위가 challenge 중이면 그 순위로 지급해야 하므로 직접 계산하지 않음
+        if ( region == name() ) {
+            rankpropSingleton rankprop( get_self(), get_self().value );
+            check( !rankprop.exists(), "ranking proposal is pending, use finalrank" );
+        }
 
-        // 한달에 한번 보상해야함
         const auto ct = currentTimePoint();
-        #ifdef TEST
-        check( ( ct.sec_since_epoch() / common::secondsPerMinute ) > ( _cstate.lastRewardsUpdate.sec_since_epoch() / common::secondsPerMinute ), "already gave rewards within this minute(test)" ); 
-        #else
-        check( ( ct.sec_since_epoch() / common::secondsPerMonth ) > ( _cstate.lastRewardsUpdate.sec_since_epoch() / common::secondsPerMonth ), "already gave rewards within this month" ); 
-        #endif
+        checkRewardsPeriod( ct, region == name() ? _cstate.lastRewardsUpdate : gitr->lastRewardsUpdate );
 
-        // 상위 16개의 병원
-        hospitalsTable hospitaltable( get_self(), get_self().value );
+        // 지역 상위 16개의 병원
+        hospitalsTable hospitaltable( get_self(), scopeOf( region ) );
         auto hospitalIdx = hospitaltable.get_index<name("byservice")>();
 
-        int cnt = 0;
-        for ( auto it = hospitalIdx.cbegin(); it != hospitalIdx.cend() && cnt < 16 && 0 < it->serviceWeight; ++it ) {
-            common::transferToken(get_self(), it->owner, common::reward, "monthly reward");
-            // 지급한 대상의 weight를 초기화해야함
-            hospitaltable.modify( *it, get_self(), [&]( HospitalInfo& h ) {
-                h.emrSales = 0;
-                h.reviewVisitors = 0;
-                h.totalReviewsLike = 0;
-                h.setWeight();
-            });
-            cnt++;
+        // 보상 중 weight가 바뀌면 인덱스 순서가 바뀌므로 대상을 먼저 모은다
+        vector<name> hospitals;
+        for ( auto it = hospitalIdx.cbegin(); it != hospitalIdx.cend() && hospitals.size() < 16 && 0 < it->serviceWeight; ++it ) {
+            hospitals.emplace_back( it->owner );
         }
 
-        // 게시글 포인트 리워드
+        // 지역 게시글 포인트 리워드
         reviewsTable reviewtable( get_self(), get_self().value );
-        customersTable customertable( get_self(), get_self().value );
-        auto reviewIdx = reviewtable.get_index<name("bylike")>();
+        auto reviewIdx = reviewtable.get_index<name("byregion")>();
 
-        cnt = 0;
-        for ( auto it = reviewIdx.cbegin(); it != reviewIdx.cend() && cnt < 16 && 100 <= it->likes && !it->Expired(); ++it ) {
-            auto citr = customertable.find( it->owner.value );
-            types::pointType rewardPoint = ( 30 - cnt ) * 1000000;
-            types::pointType bonusReward = ( rewardPoint * citr->tier ) / 100;
-            {
-                misblock::givepointAction givepointAct{ get_self(), { get_self(), name("active") } };
-                givepointAct.send( it->owner, rewardPoint + bonusReward, "monthly reward" );
+        vector<uuidType> reviews;
+        for ( auto it = reviewIdx.lower_bound( uint128_t( region.value ) << 64 ); it != reviewIdx.cend() && it->region.value_or() == region && reviews.size() < 16 && 100 <= it->likes && !it->Expired(); ++it ) {
+            reviews.emplace_back( it->id );
+        }
+
+        if ( region == name() ) {
+            payRewards( region, common::reward, hospitals, reviews );
+            _cstate.lastRewardsUpdate = ct;
+        } else {
+            // 지역 예산으로 지급할 수 있는 병원까지만 보상, 제외된 병원은 weight가 유지되어 예산을 채운 후 다시 대상이 됨
+            if ( gitr->monthlyReward.amount > 0 ) {
+                const uint64_t affordable = gitr->rewardPool.amount / gitr->monthlyReward.amount;
+                if ( hospitals.size() > affordable ) hospitals.resize( affordable );
             }
-            // addPoint( it->owner, rewardPoint );
-            reviewtable.modify( *it, get_self(), [&]( ReviewInfo& r ) {
-                r.isExpired = true;
-                while ( r.likers.begin() != r.likers.end() ) {
-                    auto itr = --r.likers.end();
-                    r.likers.erase( itr );
-                }
+            payRewards( region, gitr->monthlyReward, hospitals, reviews );
+            regiontable.modify( gitr, get_self(), [&]( RegionInfo& g ) {
+                g.rewardPool        -= g.monthlyReward * int64_t( hospitals.size() );
+                g.lastRewardsUpdate = ct;
             });
-            cnt++;
         }
+    }
+
+    void misblock::setregion( const name& region, const asset& monthlyReward, const asset& rewardPool ) {
+        // rewardPool은 남은 예산을 그대로 덮어씀, 예산을 추가하려면 현재 값에 더해서 호출
+        require_auth( get_self() );
+        check( region != name() && region != get_self(), "invalid region" );
+        check( monthlyReward.is_valid() && monthlyReward.symbol == common::S_MIS && monthlyReward.amount >= 0, "invalid monthly reward" );
+        check( rewardPool.is_valid() && rewardPool.symbol == common::S_MIS && rewardPool.amount >= 0, "invalid reward pool" );
+
+        regionsTable regiontable( get_self(), get_self().value );
+        auto gitr = regiontable.find( region.value );
+        if ( gitr == regiontable.end() ) {
+            regiontable.emplace( get_self(), [&]( RegionInfo& g ) {
+                g.region            = region;
+                g.monthlyReward     = monthlyReward;
+                g.rewardPool        = rewardPool;
+                g.hospitalCount     = 0;
+                g.lastRewardsUpdate = currentTimePoint();
+            });
+        } else {
+            regiontable.modify( gitr, get_self(), [&]( RegionInfo& g ) {
+                g.monthlyReward = monthlyReward;
+                g.rewardPool    = rewardPool;
+            });
+        }
+    }
+
+    void misblock::setrankcfg( const name& rankWorker, const uint32_t& rankChallengeWindow, const double& hospitalThreshold, const int32_t& reviewThreshold ) {
+        require_auth( get_self() );
+        check( hospitalThreshold > 0, "hospital threshold must be positive" );
+        check( reviewThreshold >= 100, "review threshold must be at least 100 likes" );
+        // 기간 안에 challenge가 끝나지 않는 제출은 항상 폐기되므로 보상 주기의 절반까지만 허용
+        check( rankChallengeWindow > 0 && rankChallengeWindow <= rewardsPeriodSeconds / 2, "challenge window must be within half of the rewards period" );
+
+        rankpropSingleton rankprop( get_self(), get_self().value );
+        check( !rankprop.exists(), "ranking proposal is pending" );
+
+        _cext.rankWorker          = rankWorker;
+        _cext.rankChallengeWindow = rankChallengeWindow;
+
+        // threshold가 바뀌면 카운터를 다시 계산
+        if ( hospitalThreshold != _cext.hospitalThreshold || reviewThreshold != _cext.reviewThreshold ) {
+            _cext.hospitalThreshold = hospitalThreshold;
+            _cext.reviewThreshold   = reviewThreshold;
+            recountRanked();
+        }
+    }
+
+    void misblock::proposerank( const vector<name>& hospitals, const vector<uuidType>& reviews ) {
+        // 오프체인 워커가 계산한 기본 지역의 상위 16개 병원/후기를 제출, 테이블 크기와 무관하게 O(K)로 검증
+        // 지역 병원과 후기는 대상이 아님, 지역 순위는 giverewards( region )이 지역 scope의 인덱스로 직접 계산
+        check( _cext.rankWorker != name(), "rank worker is not set" );
+        require_auth( _cext.rankWorker );
+        checkMigrated();
+        check( hospitals.size() <= 16 && reviews.size() <= 16, "at most 16 entries" );
+
+        rankpropSingleton rankprop( get_self(), get_self().value );
+        check( !rankprop.exists(), "ranking proposal is pending" );
+
+        const auto ct = currentTimePoint();
+        checkRewardsPeriod( ct, _cstate.lastRewardsUpdate );
+        // challenge가 끝나기 전에 보상 기간이 바뀌면 finalrank에서 폐기되므로 처음부터 받지 않음
+        const auto challengeEnd = ct + eosio::seconds( _cext.rankChallengeWindow );
+        check( rewardsPeriod( challengeEnd ) == rewardsPeriod( ct ), "challenge window would end after this rewards period" );
+
+        hospitalsTable hospitaltable( get_self(), get_self().value );
+        uint32_t above = 0;
+        for ( size_t i = 0; i < hospitals.size(); ++i ) {
+            check( regionOf( hospitals[i] ) == name(), "regional hospitals are ranked by giverewards with their region" );
+            const auto& h = hospitaltable.get( hospitals[i].value, "hospital does not exist" );
+            check( 0 < h.serviceWeight, "hospital has no weight" );
+            if ( h.serviceWeight >= _cext.hospitalThreshold ) above++;
+
+            if ( i > 0 ) {
+                // byservice 인덱스와 같은 순서: weight 내림차순, 같으면 owner 오름차순
+                const auto& prev = hospitaltable.get( hospitals[i - 1].value );
+                check( prev.serviceWeight > h.serviceWeight || ( prev.serviceWeight == h.serviceWeight && prev.owner.value < h.owner.value ), "hospitals are not strictly ordered" );
+            }
+        }
+        // threshold 이상인 병원은 모두 포함되어야 함 (16개를 넘으면 16개가 모두 threshold 이상이어야 함)
+        check( above == std::min<uint32_t>( _cext.hospitalsAbove, 16 ), "hospitals above threshold are missing" );
+
+        reviewsTable reviewtable( get_self(), get_self().value );
+        above = 0;
+        for ( size_t i = 0; i < reviews.size(); ++i ) {
+            const auto& r = reviewtable.get( reviews[i], "review does not exist" );
+            check( r.region.value_or() == name(), "regional reviews are ranked by giverewards with their region" );
+            check( !r.isExpired && 100 <= r.likes, "review is not eligible" );
+            if ( isRanked( r ) ) above++;
+
+            if ( i > 0 ) {
+                const auto& prev = reviewtable.get( reviews[i - 1] );
+                check( prev.likes > r.likes || ( prev.likes == r.likes && prev.id < r.id ), "reviews are not strictly ordered" );
+            }
+        }
+        check( above == std::min<uint32_t>( _cext.reviewsAbove, 16 ), "reviews above threshold are missing" );
+
+        // challenge는 제출 시점의 값으로 판정하므로 마지막 항목의 값을 함께 기록하고, 이후 바뀌는 row는 ranksnaps에 기록됨
+        _cext.openRankProposal = ++_cext.rankProposalSeq;
+        rankprop.set( RankProposal{
+            _cext.openRankProposal,
+            _cext.rankWorker,
+            hospitals,
+            reviews,
+            challengeEnd,
+            rewardsPeriod( ct ),
+            hospitals.empty() ? 0 : hospitaltable.get( hospitals.back().value ).serviceWeight,
+            reviews.empty() ? 0 : reviewtable.get( reviews.back() ).likes
+        }, get_self() );
+    }
+
+    void misblock::challenge( const name& challenger, const uint64_t& key, const bool& isReview ) {
+        // 제출된 순위에 빠진 row가 제출 시점에 마지막 항목보다 앞섰으면 fraud proof로 인정하고 제출을 폐기
+        // 제출 후에 올린 값으로는 challenge 할 수 없음
+        require_auth( challenger );
+
+        rankpropSingleton rankprop( get_self(), get_self().value );
+        check( rankprop.exists(), "no ranking proposal" );
+        const auto proposal = rankprop.get();
+        check( currentTimePoint() < proposal.challengeEnd, "challenge window is closed" );
+
+        bool fraud = false;
+        if ( isReview ) {
+            check( std::find( proposal.reviews.begin(), proposal.reviews.end(), key ) == proposal.reviews.end(), "review is already ranked" );
+
+            reviewsTable reviewtable( get_self(), get_self().value );
+            const auto& r = reviewtable.get( key, "review does not exist" );
+            check( r.region.value_or() == name(), "regional reviews are ranked by giverewards with their region" );
+            const int32_t likes = int32_t( rankValueAt( proposal.id, key, true, r.likes ) );
+            check( !r.isExpired && 100 <= likes, "review is not eligible" );
+
+            if ( proposal.reviews.size() < 16 ) {
+                fraud = true;
+            } else {
+                fraud = likes > proposal.lastLikes || ( likes == proposal.lastLikes && r.id < proposal.reviews.back() );
+            }
+        } else {
+            check( std::find( proposal.hospitals.begin(), proposal.hospitals.end(), name( key ) ) == proposal.hospitals.end(), "hospital is already ranked" );
+
+            check( regionOf( name( key ) ) == name(), "regional hospitals are ranked by giverewards with their region" );
+            hospitalsTable hospitaltable( get_self(), get_self().value );
+            const auto& h = hospitaltable.get( key, "hospital does not exist" );
+            const double weight = rankValueAt( proposal.id, key, false, h.serviceWeight );
+            check( 0 < weight, "hospital has no weight" );
+
+            if ( proposal.hospitals.size() < 16 ) {
+                fraud = true;
+            } else {
+                fraud = weight > proposal.lastWeight || ( weight == proposal.lastWeight && h.owner.value < proposal.hospitals.back().value );
+            }
+        }
+        check( fraud, "ranking proposal is valid" );
+
+        rankprop.remove();
+        _cext.openRankProposal = 0;
+    }
+
+    void misblock::finalrank() {
+        // challenge 기간이 지난 제출로 보상 지급, 누구나 호출 가능
+        checkMigrated();
+
+        rankpropSingleton rankprop( get_self(), get_self().value );
+        check( rankprop.exists(), "no ranking proposal" );
+        const auto proposal = rankprop.get();
+
+        const auto ct = currentTimePoint();
+        check( ct >= proposal.challengeEnd, "challenge window is still open" );
+
+        // 제출한 보상 기간이 지났으면 순위가 더 이상 유효하지 않으므로 지급하지 않고 폐기
+        rankprop.remove();
+        _cext.openRankProposal = 0;
+        if ( rewardsPeriod( ct ) != proposal.period ) {
+            eosio::printl( "stale ranking proposal is removed", 33 );
+            return;
+        }
+        checkRewardsPeriod( ct, _cstate.lastRewardsUpdate );
+
+        payRewards( name(), common::reward, proposal.hospitals, proposal.reviews );
         _cstate.lastRewardsUpdate = ct;
     }
 
-    void misblock::reghospital( const name& owner, const string& url ) {
+    void misblock::cancelrank() {
+        // 잘못된 제출을 관리자가 폐기
+        require_auth( get_self() );
+
+        rankpropSingleton rankprop( get_self(), get_self().value );
+        check( rankprop.exists(), "no ranking proposal" );
+        rankprop.remove();
+        _cext.openRankProposal = 0;
+    }
+
+    void misblock::setemrrptr( const name& emrReporter ) {
+        require_auth( get_self() );
+        is_account( emrReporter );
+        _cext.emrReporter = emrReporter;
+    }
+
+    void misblock::addemrsales( const uint64_t& windowStart, const vector<emrSale>& sales ) {
+        // 병원 별로 집계된 EMR 판매 수를 한 번에 반영, sales는 hospital 오름차순
+        check( _cext.emrReporter != name(), "emr reporter is not set" );
+        require_auth( _cext.emrReporter );
+        check( sales.size() > 0, "sales is empty" );
+
+        const uint64_t now = currentTimePoint().sec_since_epoch();
+        // window는 하루 단위로 정렬, 시작 시각을 옮겨서 같은 집계를 다른 window로 보낼 수 없음
+        check( windowStart % common::secondsPerDay == 0, "window must start at a day boundary" );
+        check( windowStart <= now, "window is in the future" );
+        check( windowStart + common::secondsPerMonth > now, "window is too old" );
+
+        emrwindowsTable windowtable( get_self(), get_self().value );
+
+        // 한 달이 지난 window는 더 이상 받지 않으므로 정리
+        for ( auto it = windowtable.begin(); it != windowtable.end() && it->windowStart + common::secondsPerMonth <= now; ) {
+            it = windowtable.erase( it );
+        }
+
+        uint64_t prev = 0;
+        for ( const auto& s : sales ) {
+            check( s.hospital.value > prev, "sales must be sorted by hospital without duplicates" );
+            prev = s.hospital.value;
+        }
+
+        const auto data = eosio::pack( sales );
+        const checksum256 chunkHash = sha256( data.data(), data.size() );
+
+        auto witr = windowtable.find( windowStart );
+        if ( witr != windowtable.end() && sales.front().hospital.value <= witr->lastHospital.value ) {
+            // 이미 반영된 청크를 그대로 다시 보낸 경우만 무시, 순서가 어긋나거나 일부만 겹치면 실패
+            check( std::find( witr->chunks.begin(), witr->chunks.end(), chunkHash ) != witr->chunks.end(), "chunk overlaps applied sales, chunks must be sent in hospital order" );
+            return;
+        }
+
+        for ( const auto& s : sales ) {
+            if ( s.sales == 0 ) continue;
+
+            hospitalsTable hospitaltable( get_self(), scopeOf( regionOf( s.hospital ) ) );
+            auto hitr = hospitaltable.find( s.hospital.value );
+            check( hitr != hospitaltable.end(), ( s.hospital.to_string() + " is not hospital" ).c_str() );
+
+            hospitaltable.modify( hitr, get_self(), [&]( HospitalInfo& h ) {
+                h.emrSales += s.sales;
+                updateWeight( h );
+            });
+        }
+
+        if ( witr == windowtable.end() ) {
+            windowtable.emplace( get_self(), [&]( EmrWindowInfo& w ) {
+                w.windowStart   = windowStart;
+                w.lastHospital  = sales.back().hospital;
+                w.chunks.emplace_back( chunkHash );
+            });
+        } else {
+            windowtable.modify( witr, get_self(), [&]( EmrWindowInfo& w ) {
+                w.lastHospital  = sales.back().hospital;
+                w.chunks.emplace_back( chunkHash );
+            });
+        }
+    }
+
+    void misblock::reghospital( const name& owner, const string& url, const name& region ) {
         check( url.size() < 512, "url too long" );
 
-        hospitalsTable hospitaltable( get_self(), get_self().value );
+        const name current = regionOf( owner );
+        hospitalsTable hospitaltable( get_self(), scopeOf( current ) );
         auto hitr = hospitaltable.find( owner.value );
 
         if ( hitr == hospitaltable.end() ) {
             require_auth( get_self() );
 
-            hospitaltable.emplace( get_self(), [&]( HospitalInfo& h ) {
+            if ( region != name() ) {
+                regionsTable regiontable( get_self(), get_self().value );
+                auto gitr = regiontable.find( region.value );
+                check( gitr != regiontable.end(), "region does not exist" );
+                regiontable.modify( gitr, get_self(), [&]( RegionInfo& g ) {
+                    g.hospitalCount++;
+                });
+
+                hospdirTable dirtable( get_self(), get_self().value );
+                dirtable.emplace( get_self(), [&]( HospitalRegionInfo& d ) {
+                    d.hospital  = owner;
+                    d.region    = region;
+                });
+            }
+
+            hospitalsTable regionhospitals( get_self(), scopeOf( region ) );
+            regionhospitals.emplace( get_self(), [&]( HospitalInfo& h ) {
                 h.owner             = owner;
                 h.url               = url;
+                h.region.emplace( region );
                 h.serviceWeight     = 0;
                 h.reviewCount       = 0;
                 h.emrSales          = 0;
@@ -159,6 +470,7 @@ namespace misblock {
             });
         } else {
             require_auth( owner );
+            check( region == current, "hospital cannot move to another region" );
 
             hospitaltable.modify( hitr, get_self(), [&]( HospitalInfo& h ) {
                 h.url = url;
@@ -176,7 +488,7 @@ namespace misblock {
         customersTable customertable( get_self(), get_self().value );
         auto citr = customertable.find( owner.value );
         check( citr != customertable.end(), "customer does not exist" );
-        check( citr->point >= point, "customer's points are insufficient" );
+        check( citr->livePoint( currentMonth(), _cext.pointExpiry ) >= point, "customer's points are insufficient" );
 
         const asset quantity = asset( uint64_t( point * pow( 10.0, S_MIS.precision() ) ) / _cstate.misByPoint, common::S_MIS );
 
@@ -186,18 +498,29 @@ namespace misblock {
         }
 
         common::transferToken( get_self(), owner, quantity, "exchange mistoken" );
+
+        bumpRollup( name(), [&]( RollupInfo& r ) {
+            r.misExchanged += quantity.amount;
+        });
     }
 
     // TODO: 무분별한 review posting을 막아야함
     // void misblock::postreview( const name& owner, const name& hospital, const uuidType& reviewId, const string& title, const string& reviewJson, const signature& sig ) {
     void misblock::postreview( const name& owner, const name& hospital, const uuidType& reviewId, const string& title, const string& reviewJson ) {
         require_auth( owner );
+        checkMigrated();
 
         customersTable customertable( get_self(), get_self().value );
         auto citr = customertable.find( owner.value );
         check( citr != customertable.end(), "you are not a customer" );
         // auto citr = customertable.require_find( owner.value, "you are not a customer" );
-        check( citr->hospitals.find( hospital ) != citr->hospitals.end(), "you must pay medical bills of that hospital through paymedical" );
+
+        // hospitals는 만료된 자격이 아직 정리되지 않았을 수 있으므로 entitlement의 만료 시각으로 판단
+        entitlementTable enttable( get_self(), get_self().value );
+        auto pairIdx = enttable.get_index<name("bypair")>();
+        auto eitr = pairIdx.find( ( uint128_t( owner.value ) << 64 ) | hospital.value );
+        check( eitr != pairIdx.end(), "you must pay medical bills of that hospital through paymedical" );
+        check( eitr->byExpiry() > currentTimePoint().sec_since_epoch(), "entitlement expired, pay medical bills of that hospital again" );
 
         check( title.size() < 512, "title should be less than 512 characters long" );
         common::validateJson( reviewJson );
@@ -233,33 +556,52 @@ namespace misblock {
         //     assert_recover_key( digest, sig, _cstate.misPubKey );
         // } 
         
-        hospitalsTable hospitaltable( get_self(), get_self().value );
+        const name region = regionOf( hospital );
+        hospitalsTable hospitaltable( get_self(), scopeOf( region ) );
         auto hitr = hospitaltable.find( hospital.value );
         check( hitr != hospitaltable.end(), "hospital does not exist" );
 
         reviewsTable reviewtable( get_self(), get_self().value );
         check( reviewtable.find( reviewId ) == reviewtable.end(), "reviewId alreay exist" );
 
+        // 같은 내용의 후기는 한 번의 조회로 거절, 길이가 앞에 붙도록 pack해서 제목과 본문의 경계가 모호하지 않게 함
+        const auto content = eosio::pack( std::make_tuple( title, reviewJson ) );
+        const checksum256 contentHash = sha256( content.data(), content.size() );
+        auto hashIdx = reviewtable.get_index<name("byhash")>();
+        check( hashIdx.find( contentHash ) == hashIdx.end(), "duplicate review" );
+
         reviewtable.emplace( get_self(), [&]( ReviewInfo& r ) {
             r.id            = reviewId;
             r.owner         = owner;
             r.hospital      = hospital;
             r.likes         = 0;
-            r.title         = title;
+            r.title         = _cext.storeTitle ? title : string();
+            r.postedAt.emplace( currentTimePoint() );
+            r.contentHash.emplace( contentHash );
+            r.region.emplace( region );
         });
 
         hospitaltable.modify( hitr, get_self(), [&]( HospitalInfo& h ) {
             h.reviewCount++;
-            h.setWeight();
+            updateWeight( h );
+        });
+        auditReview( hospital, reviewId, 1 );
+
+        bumpRollup( hospital, [&]( RollupInfo& r ) {
+            r.posts++;
         });
 
         customertable.modify( citr, get_self(), [&]( CustomerInfo& c ) {
             c.hospitals.erase( hospital );
         });
+
+        revokeEntitlement( owner, hospital );
+        popEntitlements( 2 );
     }
 
     void misblock::like( const name& owner, const uint64_t& reviewId ) {
         require_auth( owner );
+        checkMigrated();
 
         customersTable customertable( get_self(), get_self().value );
         auto citr = customertable.find( owner.value );
@@ -272,12 +614,12 @@ namespace misblock {
         check( !ritr->isExpired, "this review is expired" );
         check( ritr->likers.find( owner ) == ritr->likers.end(), "you already like it" );
 
-        hospitalsTable hospitaltable( get_self(), get_self().value );
+        hospitalsTable hospitaltable( get_self(), scopeOf( ritr->region.value_or() ) );
         // auto hitr = hospitaltable.require_find( ritr->hospital.value, "hospital does not exist" );
         auto hitr = hospitaltable.find( ritr->hospital.value );
         check( hitr != hospitaltable.end(), "hospital does not exist" );
 
-        types::pointType bonusReward = ( _cstate.likeReward * citr->tier ) / 100;
+        types::pointType bonusReward = ( _cstate.likeReward * citr->liveTier( currentMonth(), _cext.pointExpiry ) ) / 100;
         {
             misblock::givepointAction givepointAct{ get_self(), { get_self(), name("active") } };
             givepointAct.send( owner, _cstate.likeReward + bonusReward, "reward like" );
@@ -287,31 +629,678 @@ namespace misblock {
         // 하루에 세번 좋아요
         const auto ct = currentTimePoint();
         customertable.modify( citr, get_self(), [&]( CustomerInfo& c ) {
-            // 하루가 지났으면
-            #ifdef TEST
-            if ( ( ct.sec_since_epoch() / common::secondsPerMinute) > ( citr->lastLikeTime.sec_since_epoch() / common::secondsPerMinute ) ) {
-            #else
-            if ( ( ct.sec_since_epoch() / common::secondsPerDay) > ( citr->lastLikeTime.sec_since_epoch() / common::secondsPerDay ) ) {
-            #endif
-                c.remainLike = 2;
-            } else {
-                check( citr->remainLike, "there are no remaining likes" );
-                c.remainLike--;
-            }
-            c.lastLikeTime = ct;
+            useLikes( c, ct, 1 );
         });
 
+        const bool ranked = isRanked( *ritr );
+        if ( ritr->region.value_or() == name() ) snapshotRank( ritr->id, true, ritr->likes );
         reviewtable.modify( ritr, get_self(), [&]( ReviewInfo& r ) {
             r.likes++;
             r.likers.emplace( owner );
         });
+        updateRanked( ranked, isRanked( *ritr ) );
 
         hospitaltable.modify( hitr, get_self(), [&]( HospitalInfo& h ) {
             h.totalReviewsLike++;
-            h.setWeight();
+            updateWeight( h );
+        });
+
+        bumpRollup( hitr->owner, [&]( RollupInfo& r ) {
+            r.likes++;
+        });
+    }
+
+    void misblock::prune( const uint32_t& limit, const bool& archive ) {
+        // 만료되었거나 보관 기간이 지난 후기를 최대 limit개 만큼 정리
+        // archive == true 이면 고정 크기 요약본을 archives 테이블에 남기고, 아니면 완전히 삭제
+        require_auth( get_self() );
+        checkMigrated();
+        check( limit > 0, "limit must be positive" );
+
+        const auto ct = currentTimePoint();
+        check( ct.sec_since_epoch() > _cext.reviewRetention, "retention window exceeds current time" );
+        const uint64_t cutoff = ct.sec_since_epoch() - _cext.reviewRetention;
+
+        reviewsTable reviewtable( get_self(), get_self().value );
+        archivesTable archivetable( get_self(), get_self().value );
+        auto staleIdx = reviewtable.get_index<name("bystale")>();
+
+        uint32_t cnt = 0;
+        for ( auto it = staleIdx.begin(); it != staleIdx.end() && cnt < limit && it->byStale() < cutoff; ++cnt ) {
+            if ( archive && archivetable.find( it->id ) == archivetable.end() ) {
+                archivetable.emplace( get_self(), [&]( ArchivedReviewInfo& a ) {
+                    a.id            = it->id;
+                    a.owner         = it->owner;
+                    a.hospital      = it->hospital;
+                    a.likes         = it->likes;
+                    a.contentHash   = it->contentHash.value_or();
+                });
+            }
+
+            hospitalsTable hospitaltable( get_self(), scopeOf( it->region.value_or() ) );
+            auto hitr = hospitaltable.find( it->hospital.value );
+            if ( hitr != hospitaltable.end() && hitr->reviewCount > 0 ) {
+                hospitaltable.modify( hitr, get_self(), [&]( HospitalInfo& h ) {
+                    h.reviewCount--;
+                    updateWeight( h );
+                });
+            }
+
+            updateRanked( isRanked( *it ), false );
+            auditReview( it->hospital, it->id, -1 );
+            it = staleIdx.erase( it );
+        }
+        check( cnt > 0, "nothing to prune" );
+    }
+
+    void misblock::settlecash( const name& hospital, const vector<cashReceipt>& receipts ) {
+        // 병원이 하루치 현금 결제를 한 번에 정산, 미리 입금해 둔 cashdeposit 잔액에서 차감
+        require_auth( hospital );
+        check( receipts.size() > 0, "receipts is empty" );
+        check( receipts.size() <= 256, "too many receipts" );
+
+        hospitalsTable hospitaltable( get_self(), scopeOf( regionOf( hospital ) ) );
+        auto hitr = hospitaltable.find( hospital.value );
+        check( hitr != hospitaltable.end(), ( hospital.to_string() + " is not hospital" ).c_str() );
+
+        reviewsTable reviewtable( get_self(), get_self().value );
+
+        // 고객별 보상을 모아서 정렬된 키 순서로 한 번씩만 수정
+        map<name, pointType> rewards;
+        set<name> payers;
+        // asset의 덧셈은 max_amount를 넘으면 실패하므로 합계가 overflow 되지 않음
+        asset totalCost( 0, common::S_MIS );
+        uint32_t visitors = 0;
+
+        for ( const auto& r : receipts ) {
+            check( r.cost.is_valid(), "invalid quantity" );
+            check( r.cost.symbol == common::S_MIS, "invalid symbol" );
+            check( r.cost.amount >= 10000, "minimum quantity is 1 MIS" );
+            totalCost += r.cost;
+
+            if ( r.reviewId == nullID ) {
+                rewards[r.customer] += ( r.cost.amount * 0.3 ) / 100;
+            } else {
+                auto ritr = reviewtable.find( r.reviewId );
+                check( ritr != reviewtable.end(), "review does not exist" );
+                check( ritr->owner != r.customer, "customer and the reviewer cannot be the same" );
+                check( ritr->hospital == hospital, "invalid reviewId" );
+
+                rewards[r.customer] += ( r.cost.amount * 0.5 ) / 100;
+                rewards[ritr->owner] += ( r.cost.amount * 0.4 ) / 100;
+                visitors++;
+            }
+            payers.emplace( r.customer );
+        }
+
+        cashdepositTable deposittable( get_self(), get_self().value );
+        auto ditr = deposittable.find( hospital.value );
+        check( ditr != deposittable.end(), "no cash deposit" );
+        check( ditr->balance >= totalCost, "cash deposit is insufficient" );
+
+        if ( ditr->balance == totalCost ) {
+            deposittable.erase( ditr );
+        } else {
+            deposittable.modify( ditr, get_self(), [&]( CashDepositInfo& d ) {
+                d.balance -= totalCost;
+            });
+        }
+
+        customersTable customertable( get_self(), get_self().value );
+        for ( const auto& reward : rewards ) {
+            auto citr = customertable.find( reward.first.value );
+            check( citr != customertable.end(), "customer does not exist" );
+
+            customertable.modify( citr, get_self(), [&]( CustomerInfo& c ) {
+                if ( reward.second > 0 ) creditPoint( c, reward.second );
+                if ( payers.count( reward.first ) ) c.hospitals.emplace( hospital );
+            });
+        }
+
+        if ( visitors ) {
+            hospitaltable.modify( hitr, get_self(), [&]( HospitalInfo& h ) {
+                h.reviewVisitors += visitors;
+                updateWeight( h );
+            });
+        }
+
+        for ( const auto& payer : payers ) {
+            grantEntitlement( payer, hospital );
+        }
+        popEntitlements( 2 );
+
+        bumpRollup( hospital, [&]( RollupInfo& r ) {
+            r.payments += receipts.size();
+            r.paidAmount += totalCost.amount;
         });
     }
 
+    void misblock::withdrawcash( const name& hospital, const asset& quantity ) {
+        require_auth( hospital );
+        check( quantity.is_valid(), "invalid quantity" );
+        check( quantity.symbol == common::S_MIS, "invalid symbol" );
+        check( quantity.amount > 0, "must withdraw positive quantity" );
+
+        cashdepositTable deposittable( get_self(), get_self().value );
+        auto ditr = deposittable.find( hospital.value );
+        check( ditr != deposittable.end(), "no cash deposit" );
+        check( ditr->balance >= quantity, "cash deposit is insufficient" );
+
+        if ( ditr->balance == quantity ) {
+            deposittable.erase( ditr );
+        } else {
+            deposittable.modify( ditr, get_self(), [&]( CashDepositInfo& d ) {
+                d.balance -= quantity;
+            });
+        }
+
+        common::transferToken( get_self(), hospital, quantity, "cash deposit withdrawal" );
+    }
+
+    void misblock::loadcustomr( const vector<customerRow>& rows ) {
+        require_auth( get_self() );
+
+        customersTable customertable( get_self(), get_self().value );
+        uint64_t prev = 0;
+        for ( const auto& row : rows ) {
+            check( row.owner.value > prev, "rows must be sorted by owner without duplicates" );
+            check( customertable.find( row.owner.value ) == customertable.end(), ( row.owner.to_string() + " already exist" ).c_str() );
+            prev = row.owner.value;
+
+            customertable.emplace( get_self(), [&]( CustomerInfo& c ) {
+                c.owner         = row.owner;
+                c.hospitals     = row.hospitals;
+                c.remainLike    = row.remainLike;
+                c.lastLikeTime  = row.lastLikeTime;
+                // buckets가 없는 이전 버전의 덤프는 현재 달에 적립된 것으로 취급
+                c.buckets.emplace();
+                if ( row.buckets.has_value() ) {
+                    *c.buckets = *row.buckets;
+                } else if ( row.point > 0 ) {
+                    c.buckets->emplace_back( pointBucket{ currentMonth(), row.point } );
+                }
+                c.point = 0;
+                for ( const auto& b : *c.buckets ) {
+                    c.point += b.amount;
+                    updateVintage( b.month, b.amount );
+                }
+                c.setTier();
+                _cstate.totalPointSupply += c.point;
+            });
+            const auto& loaded = customertable.get( row.owner.value );
+            auditPoint( row.owner, loaded.livePoint( currentMonth(), _cext.pointExpiry ) );
+            backfillEntitlements( loaded );
+        }
+    }
+
+    void misblock::loadhospital( const vector<hospitalRow>& rows ) {
+        require_auth( get_self() );
+
+        hospitalsTable defaulthospitals( get_self(), get_self().value );
+        regionsTable regiontable( get_self(), get_self().value );
+        hospdirTable dirtable( get_self(), get_self().value );
+        uint64_t prev = 0;
+        for ( const auto& row : rows ) {
+            check( row.owner.value > prev, "rows must be sorted by owner without duplicates" );
+            check( dirtable.find( row.owner.value ) == dirtable.end() && defaulthospitals.find( row.owner.value ) == defaulthospitals.end(), ( row.owner.to_string() + " already exist" ).c_str() );
+            prev = row.owner.value;
+
+            // 이전 버전의 덤프에는 지역이 없으므로 기본 지역
+            const name region = row.region.value_or( name() );
+            if ( region != name() ) {
+                auto gitr = regiontable.find( region.value );
+                check( gitr != regiontable.end(), "region does not exist" );
+                regiontable.modify( gitr, get_self(), [&]( RegionInfo& g ) {
+                    g.hospitalCount++;
+                });
+                dirtable.emplace( get_self(), [&]( HospitalRegionInfo& d ) {
+                    d.hospital  = row.owner;
+                    d.region    = region;
+                });
+            }
+
+            hospitalsTable hospitaltable( get_self(), scopeOf( region ) );
+            hospitaltable.emplace( get_self(), [&]( HospitalInfo& h ) {
+                h.owner             = row.owner;
+                h.url               = row.url;
+                h.reviewCount       = row.reviewCount;
+                h.emrSales          = row.emrSales;
+                h.reviewVisitors    = row.reviewVisitors;
+                h.totalReviewsLike  = row.totalReviewsLike;
+                h.region.emplace( region );
+                h.serviceWeight = 0;
+                updateWeight( h );
+            });
+        }
+    }
+
+    void misblock::loadreviews( const vector<reviewRow>& rows ) {
+        require_auth( get_self() );
+
+        reviewsTable reviewtable( get_self(), get_self().value );
+        for ( size_t i = 0; i < rows.size(); ++i ) {
+            check( i == 0 || rows[i].id > rows[i - 1].id, "rows must be sorted by id without duplicates" );
+            check( reviewtable.find( rows[i].id ) == reviewtable.end(), "reviewId alreay exist" );
+
+            // 이전 버전의 덤프는 적재한 시각을 작성 시각으로 취급하고, 지역은 이미 적재된 병원에서 찾음
+            ReviewInfo row;
+            row.id          = rows[i].id;
+            row.owner       = rows[i].owner;
+            row.hospital    = rows[i].hospital;
+            row.likers      = rows[i].likers;
+            row.isExpired   = rows[i].isExpired;
+            row.likes       = rows[i].likes;
+            row.title       = rows[i].title;
+            row.postedAt.emplace( rows[i].postedAt.value_or( currentTimePoint() ) );
+            row.contentHash.emplace( rows[i].contentHash.value_or( checksum256() ) );
+            row.region.emplace( rows[i].region.value_or( regionOf( rows[i].hospital ) ) );
+
+            reviewtable.emplace( get_self(), [&]( ReviewInfo& r ) {
+                r = row;
+            });
+            updateRanked( false, isRanked( row ) );
+            // 제출 후에 적재된 후기는 제출 시점에 없었으므로 좋아요 0으로 기록
+            if ( *row.region == name() ) snapshotRank( row.id, true, 0 );
+            auditReview( rows[i].hospital, rows[i].id, 1 );
+        }
+    }
+
+    void misblock::openchannel( const name& customer, const name& hospital, const uuidType& channelId, const public_key& customerKey, const uint32_t& timeout ) {
+        require_auth( customer );
+        check( customerKey != public_key(), "public key should not be the default value" );
+        check( timeout >= 10 * common::secondsPerMinute && timeout <= common::secondsPerDay, "timeout must be between 10 minutes and 1 day" );
+
+        customersTable customertable( get_self(), get_self().value );
+        check( customertable.find( customer.value ) != customertable.end(), "you are not a customer" );
+
+        hospitalsTable hospitaltable( get_self(), scopeOf( regionOf( hospital ) ) );
+        check( hospitaltable.find( hospital.value ) != hospitaltable.end(), ( hospital.to_string() + " is not hospital" ).c_str() );
+
+        channelsTable channeltable( get_self(), get_self().value );
+        check( channeltable.find( channelId ) == channeltable.end(), "channelId already exist" );
+
+        // 채널 수에 제한이 없으므로 RAM은 고객이 부담, 채널을 닫으면 돌려받음
+        channeltable.emplace( customer, [&]( ChannelInfo& ch ) {
+            ch.id           = channelId;
+            ch.customer     = customer;
+            ch.hospital     = hospital;
+            ch.customerKey  = customerKey;
+            ch.deposit      = asset( 0, common::S_MIS );
+            ch.expiresAt    = currentTimePoint() + eosio::seconds( timeout );
+            ch.nonce        = ++_cext.channelSeq;
+        });
+    }
+
+    void misblock::settlechan( const name& hospital, const uuidType& channelId, const asset& amount, const signature& sig ) {
+        // 병원이 마지막 voucher로 한 번에 정산, 남은 예치금은 고객에게 환불
+        require_auth( hospital );
+
+        channelsTable channeltable( get_self(), get_self().value );
+        auto chitr = channeltable.find( channelId );
+        check( chitr != channeltable.end(), "channel does not exist" );
+        check( chitr->hospital == hospital, "invalid channel" );
+        check( amount.symbol == common::S_MIS && amount.amount > 0, "invalid amount" );
+        check( amount <= chitr->deposit, "voucher exceeds deposit" );
+
+        // 닫힌 채널과 같은 id로 다시 열어도 nonce가 다르므로 이전 voucher는 검증되지 않음
+        const auto data = eosio::pack( std::make_tuple( get_self(), channelId, chitr->customer, hospital, chitr->nonce, amount ) );
+        const checksum256 digest = sha256( data.data(), data.size() );
+        assert_recover_key( digest, sig, chitr->customerKey );
+
+        const name customer = chitr->customer;
+        const asset refund = chitr->deposit - amount;
+        channeltable.erase( chitr );
+
+        common::transferToken( get_self(), hospital, amount, "teleconsultation" );
+        if ( refund.amount > 0 ) {
+            common::transferToken( get_self(), customer, refund, "teleconsultation refund" );
+        }
+
+        // precision = 4, 1 mis == 100 point => devide 100
+        types::pointType payReward = ( amount.amount * 0.03 ) / 100;
+        if ( payReward > 0 ) {
+            misblock::givepointAction givepointAct{ get_self(), { get_self(), name("active") } };
+            givepointAct.send( customer, payReward, "reward teleconsultation" );
+        }
+
+        customersTable customertable( get_self(), get_self().value );
+        auto citr = customertable.find( customer.value );
+        if ( citr != customertable.end() ) {
+            customertable.modify( citr, get_self(), [&]( CustomerInfo& c ) {
+                c.hospitals.emplace( hospital );
+            });
+            grantEntitlement( customer, hospital );
+            popEntitlements( 2 );
+        }
+
+        bumpRollup( hospital, [&]( RollupInfo& r ) {
+            r.payments++;
+            r.paidAmount += amount.amount;
+        });
+    }
+
+    void misblock::refundchan( const name& customer, const uuidType& channelId ) {
+        // 병원이 기한 내에 정산하지 않으면 고객이 예치금 전액을 돌려받음
+        require_auth( customer );
+
+        channelsTable channeltable( get_self(), get_self().value );
+        auto chitr = channeltable.find( channelId );
+        check( chitr != channeltable.end(), "channel does not exist" );
+        check( chitr->customer == customer, "invalid channel" );
+        check( currentTimePoint() >= chitr->expiresAt, "channel is not expired" );
+
+        const asset refund = chitr->deposit;
+        channeltable.erase( chitr );
+
+        if ( refund.amount > 0 ) {
+            common::transferToken( get_self(), customer, refund, "teleconsultation refund" );
+        }
+    }
+
+    void misblock::setlikekey( const name& owner, const public_key& likeKey ) {
+        require_auth( owner );
+        check( likeKey != public_key(), "public key should not be the default value" );
+
+        customersTable customertable( get_self(), get_self().value );
+        check( customertable.find( owner.value ) != customertable.end(), "you are not a customer" );
+
+        relaykeysTable keytable( get_self(), get_self().value );
+        auto kitr = keytable.find( owner.value );
+        if ( kitr == keytable.end() ) {
+            keytable.emplace( get_self(), [&]( RelayKeyInfo& k ) {
+                k.owner     = owner;
+                k.likeKey   = likeKey;
+                k.nonce     = 0;
+            });
+        } else {
+            keytable.modify( kitr, get_self(), [&]( RelayKeyInfo& k ) {
+                k.likeKey   = likeKey;
+            });
+        }
+    }
+
+    void misblock::relaylikes( const name& relayer, const vector<likeIntent>& likes ) {
+        // 고객이 서명한 좋아요를 relayer가 모아서 제출, 후기/병원 별로 묶어서 한 번씩만 수정
+        require_auth( relayer );
+        checkMigrated();
+        check( likes.size() > 0, "likes is empty" );
+        check( likes.size() <= 64, "too many likes" );
+
+        // 서명과 nonce 검증
+        relaykeysTable keytable( get_self(), get_self().value );
+        map<name, uint64_t> nonces;
+        map<name, uint8_t> likesByOwner;
+        map<uuidType, vector<name>> likersByReview;
+
+        for ( const auto& l : likes ) {
+            auto kitr = keytable.find( l.owner.value );
+            check( kitr != keytable.end(), ( l.owner.to_string() + " has no like key" ).c_str() );
+
+            auto nitr = nonces.find( l.owner );
+            const uint64_t last = nitr == nonces.end() ? kitr->nonce : nitr->second;
+            check( l.nonce > last, "nonce must increase" );
+            nonces[l.owner] = l.nonce;
+
+            const auto data = eosio::pack( std::make_tuple( get_self(), l.owner, l.reviewId, l.nonce ) );
+            const checksum256 digest = sha256( data.data(), data.size() );
+            assert_recover_key( digest, l.sig, kitr->likeKey );
+
+            likesByOwner[l.owner]++;
+            likersByReview[l.reviewId].emplace_back( l.owner );
+        }
+
+        for ( const auto& n : nonces ) {
+            keytable.modify( keytable.find( n.first.value ), get_self(), [&]( RelayKeyInfo& k ) {
+                k.nonce = n.second;
+            });
+        }
+
+        // 고객 별 하루 좋아요 제한과 보상
+        customersTable customertable( get_self(), get_self().value );
+        const auto ct = currentTimePoint();
+        const uint32_t month = currentMonth();
+
+        for ( const auto& o : likesByOwner ) {
+            auto citr = customertable.find( o.first.value );
+            check( citr != customertable.end(), "you are not a customer" );
+
+            types::pointType bonusReward = ( _cstate.likeReward * citr->liveTier( month, _cext.pointExpiry ) ) / 100;
+            customertable.modify( citr, get_self(), [&]( CustomerInfo& c ) {
+                useLikes( c, ct, o.second );
+                creditPoint( c, ( _cstate.likeReward + bonusReward ) * o.second );
+            });
+        }
+
+        // 후기 별 좋아요, 병원 별 합계
+        reviewsTable reviewtable( get_self(), get_self().value );
+        map<name, uint32_t> likesByHospital;
+
+        for ( const auto& r : likersByReview ) {
+            auto ritr = reviewtable.find( r.first );
+            check( ritr != reviewtable.end(), "review does not exist" );
+            check( !ritr->isExpired, "this review is expired" );
+
+            const bool ranked = isRanked( *ritr );
+            if ( ritr->region.value_or() == name() ) snapshotRank( ritr->id, true, ritr->likes );
+            reviewtable.modify( ritr, get_self(), [&]( ReviewInfo& rv ) {
+                for ( const auto& owner : r.second ) {
+                    check( rv.likers.emplace( owner ).second, "you already like it" );
+                }
+                rv.likes += r.second.size();
+            });
+            updateRanked( ranked, isRanked( *ritr ) );
+
+            likesByHospital[ritr->hospital] += r.second.size();
+        }
+
+        for ( const auto& h : likesByHospital ) {
+            hospitalsTable hospitaltable( get_self(), scopeOf( regionOf( h.first ) ) );
+            auto hitr = hospitaltable.find( h.first.value );
+            check( hitr != hospitaltable.end(), "hospital does not exist" );
+
+            hospitaltable.modify( hitr, get_self(), [&]( HospitalInfo& hp ) {
+                hp.totalReviewsLike += h.second;
+                updateWeight( hp );
+            });
+
+            bumpRollup( h.first, [&]( RollupInfo& r ) {
+                r.likes += h.second;
+            });
+        }
+    }
+
+    void misblock::audit( const uint32_t& limit ) {
+        // 테이블을 limit개 씩 나눠서 검사, 부분합은 config에 보관하고 다음 호출에서 이어서 진행
+        require_auth( get_self() );
+        checkMigrated();
+        check( limit > 0 && limit <= 500, "limit must be between 1 and 500" );
+
+        rollVintages();
+        const uint32_t month = currentMonth();
+
+        // 달이 바뀌면 소멸 기준이 달라지므로 처음부터 다시 검사
+        if ( _cext.auditPhase == 0 || ( _cext.auditPhase == 1 && _cext.auditMonth != month ) ) {
+            _cext.auditPhase      = 1;
+            _cext.auditCursor     = 0;
+            _cext.auditSubCursor  = 0;
+            _cext.auditMonth      = month;
+            _cext.auditPointSum   = 0;
+            _cext.auditReviewSum  = 0;
+            _cext.auditRegion     = name();
+        }
+
+        uint32_t cnt = 0;
+        if ( _cext.auditPhase == 1 ) {
+            customersTable customertable( get_self(), get_self().value );
+            auto it = customertable.lower_bound( _cext.auditCursor );
+            for ( ; it != customertable.end() && cnt < limit; ++it, ++cnt ) {
+                pointType bucketSum = 0;
+                for ( const auto& b : it->buckets.value_or() ) bucketSum += b.amount;
+                if ( bucketSum != it->point ) {
+                    auditMismatch( CUSTOMER_BUCKETS, it->owner.value, it->owner.value, bucketSum, it->point );
+                }
+
+                _cext.auditPointSum += it->livePoint( month, _cext.pointExpiry );
+                _cext.auditCursor = it->owner.value + 1;
+            }
+            if ( it != customertable.end() ) return;
+
+            if ( _cext.auditPointSum != _cstate.totalPointSupply ) {
+                auditMismatch( POINT_SUPPLY, 0, _cext.auditCursor - 1, _cstate.totalPointSupply, _cext.auditPointSum );
+            }
+            _cext.auditPhase      = 2;
+            _cext.auditCursor     = 0;
+            _cext.auditSubCursor  = 0;
+            _cext.auditReviewSum  = 0;
+            _cext.auditRegion     = name();
+        }
+
+        regionsTable regiontable( get_self(), get_self().value );
+        reviewsTable reviewtable( get_self(), get_self().value );
+        auto reviewIdx = reviewtable.get_index<name("byhospital")>();
+
+        // 병원은 지역 scope에 나뉘어 있으므로 기본 지역("")의 병원을 먼저 검사하고 regions 순서대로 다음 지역으로 넘어감
+        while ( true ) {
+            hospitalsTable hospitaltable( get_self(), scopeOf( _cext.auditRegion ) );
+            auto hitr = hospitaltable.lower_bound( _cext.auditCursor );
+            while ( hitr != hospitaltable.end() && cnt < limit ) {
+                _cext.auditCursor = hitr->owner.value;
+
+                auto ritr = reviewIdx.lower_bound( ( uint128_t( hitr->owner.value ) << 64 ) | _cext.auditSubCursor );
+                for ( ; ritr != reviewIdx.end() && ritr->hospital == hitr->owner && cnt < limit; ++ritr, ++cnt ) {
+                    _cext.auditReviewSum++;
+                    _cext.auditSubCursor = ritr->id + 1;
+                }
+                // 병원의 후기를 다 세지 못했으면 다음 호출에서 이어서
+                if ( ritr != reviewIdx.end() && ritr->hospital == hitr->owner ) return;
+
+                if ( _cext.auditReviewSum != hitr->reviewCount ) {
+                    auditMismatch( REVIEW_COUNT, hitr->owner.value, hitr->owner.value, hitr->reviewCount, _cext.auditReviewSum );
+                }
+                _cext.auditSubCursor = 0;
+                _cext.auditReviewSum = 0;
+                ++hitr;
+                ++cnt;
+                _cext.auditCursor = hitr != hospitaltable.end() ? hitr->owner.value : 0;
+            }
+            if ( hitr != hospitaltable.end() ) return;
+
+            auto gitr = regiontable.upper_bound( _cext.auditRegion.value );
+            if ( gitr == regiontable.end() ) break;
+            _cext.auditRegion = gitr->region;
+            _cext.auditCursor = 0;
+        }
+
+        eosio::printl( "audit completed", 15 );
+        _cext.auditPhase  = 0;
+        _cext.auditRegion = name();
+    }
+
+    void misblock::setrollupret( const uint32_t& rollupRetention ) {
+        require_auth( get_self() );
+        check( rollupRetention > 0 && rollupRetention <= 366, "retention must be between 1 and 366 days" );
+        _cext.rollupRetention = rollupRetention;
+    }
+
+    void misblock::getrollups( const name& hospital, const uint32_t& fromDay, const uint32_t& toDay ) {
+        check( fromDay <= toDay, "invalid day range" );
+        check( toDay - fromDay < _cext.rollupRetention, "day range exceeds retention" );
+
+        eosio::print( "[" );
+        for ( uint32_t day = fromDay; day <= toDay; ++day ) {
+            rollupsTable rolluptable( get_self(), day );
+            auto ritr = rolluptable.find( hospital.value );
+            if ( ritr == rolluptable.end() ) continue;
+
+            eosio::print( "{\"day\":", day,
+                          ",\"likes\":", ritr->likes,
+                          ",\"posts\":", ritr->posts,
+                          ",\"payments\":", ritr->payments,
+                          ",\"paidAmount\":", ritr->paidAmount,
+                          ",\"pointsIssued\":", ritr->pointsIssued,
+                          ",\"misExchanged\":", ritr->misExchanged, "}" );
+        }
+        eosio::print( "]" );
+    }
+
+    void misblock::setentttl( const uint32_t& entitlementTTL ) {
+        require_auth( get_self() );
+        check( entitlementTTL >= common::secondsPerDay, "ttl must be at least one day" );
+        _cext.entitlementTTL = entitlementTTL;
+    }
+
+    void misblock::expireents( const uint32_t& limit ) {
+        // 누구나 호출해서 만료된 후기 작성 자격을 정리할 수 있음
+        check( limit > 0 && limit <= 100, "limit must be between 1 and 100" );
+        popEntitlements( limit );
+    }
+
+    void misblock::migrate( const uint32_t& limit ) {
+        // 이전 버전에서 업그레이드한 후 limit개 씩 나눠서 호출, 진행 상태는 configext에 보관
+        // phase 1: 고객의 기존 포인트를 현재 달의 bucket으로 채우고, 기존 hospitals 항목에 지금부터 entitlementTTL 동안의 자격을 부여
+        // phase 2: 후기를 다시 emplace하여 새 인덱스(bystale, byhash, byhospital, byregion)에 등록, 작성 시각은 현재 시각으로 취급
+        //          인덱스 번호가 바뀌었으므로 이전 타입의 테이블로 지워서 예전 bylike 항목도 함께 삭제
+        // phase 3: 순위 threshold 카운터를 기존 row로부터 다시 계산
+        require_auth( get_self() );
+        check( _cext.migrationPhase != 0, "nothing to migrate" );
+        check( limit > 0 && limit <= 500, "limit must be between 1 and 500" );
+
+        const uint32_t month = currentMonth();
+        rollVintages();
+
+        uint32_t cnt = 0;
+        if ( _cext.migrationPhase == 1 ) {
+            customersTable customertable( get_self(), get_self().value );
+            auto it = customertable.lower_bound( _cext.migrationCursor );
+            for ( ; it != customertable.end() && cnt < limit; ++it, ++cnt ) {
+                if ( !it->buckets.has_value() ) {
+                    customertable.modify( it, get_self(), [&]( CustomerInfo& c ) {
+                        seedBuckets( c, month );
+                    });
+                }
+                // buckets가 이미 채워진 고객도 자격 row가 없을 수 있으므로 따로 확인
+                backfillEntitlements( *it );
+                _cext.migrationCursor = it->owner.value + 1;
+            }
+            if ( it != customertable.end() ) return;
+
+            _cext.migrationPhase    = 2;
+            _cext.migrationCursor   = 0;
+        }
+
+        if ( _cext.migrationPhase == 2 ) {
+            reviewsTable reviewtable( get_self(), get_self().value );
+            legacyReviewsTable legacytable( get_self(), get_self().value );
+            auto it = reviewtable.lower_bound( _cext.migrationCursor );
+            for ( ; it != reviewtable.end() && cnt < limit; ++cnt ) {
+                _cext.migrationCursor = it->id + 1;
+                if ( it->postedAt.has_value() ) {
+                    ++it;
+                    continue;
+                }
+
+                ReviewInfo row = *it;
+                row.postedAt.emplace( currentTimePoint() );
+                row.contentHash.emplace();
+                row.region.emplace( regionOf( row.hospital ) );
+
+                legacytable.erase( legacytable.find( row.id ) );
+                reviewtable.emplace( get_self(), [&]( ReviewInfo& r ) {
+                    r = row;
+                });
+                it = reviewtable.lower_bound( _cext.migrationCursor );
+            }
+            if ( it != reviewtable.end() ) return;
+
+            _cext.migrationPhase    = 3;
+            _cext.migrationCursor   = 0;
+        }
+
+        recountRanked();
+        _cext.migrationPhase = 0;
+        eosio::printl( "migration completed", 19 );
+    }
+
     void misblock::transferevnt( const uint64_t& sender, const uint64_t& receiver ) {
         misblock::transferEventHandler( sender, receiver, [&]( const types::eventArgs& e ) {
             check( e.action.size(), "Invalid transfer" );
@@ -358,9 +1347,17 @@ namespace misblock {
                     }
                 }
                 break;
+            case common::constHash( "depositcash" ):
+                if ( e.action == "depositcash" ) {
+                    // memo => "depositcash", settlecash로 일괄 정산하기 위한 병원의 선입금
+                    depositcash( e.from, e.quantity );
+                }
+                break;
             case common::constHash( "payconsmis" ):
                 if ( e.action == "payconsmis" ) {
-                    // TODO: 추후 원격상담 결제 "payconsmis:hospitalName:???"
+                    // memo => "payconsmis:channelId", openchannel로 연 채널에 예치
+                    types::uuidType channelId = stoull(e.param[0]);
+                    payconsmis( e.from, channelId, e.quantity );
                 }
                 break;
             default:
@@ -412,7 +1409,7 @@ namespace misblock {
     // TODO: 무분별한 transfer로 인한 어뷰징을 막아야함
     void misblock::paybillmis( const name& customer, const name& hospital, const asset& cost, const uuidType& reviewId ) {
         customersTable customertable( get_self(), get_self().value );
-        hospitalsTable hospitaltable( get_self(), get_self().value );
+        hospitalsTable hospitaltable( get_self(), scopeOf( regionOf( hospital ) ) );
         reviewsTable reviewtable( get_self(), get_self().value );
 
         auto citr = customertable.find( customer.value );
@@ -461,19 +1458,26 @@ namespace misblock {
 
             hospitaltable.modify( hitr, get_self(), [&]( HospitalInfo& h ) {
                 h.reviewVisitors++;
-                h.setWeight();
+                updateWeight( h );
             }); 
         }
 
         customertable.modify( citr, get_self(), [&]( CustomerInfo& c ) {
             c.hospitals.emplace( hospital );
         });
+        grantEntitlement( customer, hospital );
+        popEntitlements( 2 );
+
+        bumpRollup( hospital, [&]( RollupInfo& r ) {
+            r.payments++;
+            r.paidAmount += cost.amount;
+        });
     }
 
     // TODO: 무분별한 transfer로 인한 어뷰징을 막아야함
     void misblock::paybillcash( const name& customer, const name& hospital, const asset& cost, const uuidType& reviewId ) {
         customersTable customertable( get_self(), get_self().value );
-        hospitalsTable hospitaltable( get_self(), get_self().value );
+        hospitalsTable hospitaltable( get_self(), scopeOf( regionOf( hospital ) ) );
         reviewsTable reviewtable( get_self(), get_self().value );
 
         auto citr = customertable.find( customer.value );
@@ -519,13 +1523,321 @@ namespace misblock {
 
             hospitaltable.modify( hitr, get_self(), [&]( HospitalInfo& h ) {
                 h.reviewVisitors++;
-                h.setWeight();
+                updateWeight( h );
             }); 
         }
 
         customertable.modify( citr, get_self(), [&]( CustomerInfo& c ) {
             c.hospitals.emplace( hospital );
         });
+        grantEntitlement( customer, hospital );
+        popEntitlements( 2 );
+
+        bumpRollup( hospital, [&]( RollupInfo& r ) {
+            r.payments++;
+            r.paidAmount += cost.amount;
+        });
+    }
+
+    void misblock::depositcash( const name& hospital, const asset& quantity ) {
+        hospitalsTable hospitaltable( get_self(), scopeOf( regionOf( hospital ) ) );
+        check( hospitaltable.find( hospital.value ) != hospitaltable.end(), ( hospital.to_string() + " is not hospital" ).c_str() );
+
+        cashdepositTable deposittable( get_self(), get_self().value );
+        auto ditr = deposittable.find( hospital.value );
+        if ( ditr == deposittable.end() ) {
+            deposittable.emplace( get_self(), [&]( CashDepositInfo& d ) {
+                d.hospital  = hospital;
+                d.balance   = quantity;
+            });
+        } else {
+            deposittable.modify( ditr, get_self(), [&]( CashDepositInfo& d ) {
+                d.balance += quantity;
+            });
+        }
+    }
+
+    void misblock::checkRewardsPeriod( const time_point& ct, const time_point& lastRewardsUpdate ) {
+        // 한달에 한번 보상해야함
+        #ifdef TEST
+        check( rewardsPeriod( ct ) > rewardsPeriod( lastRewardsUpdate ), "already gave rewards within this minute(test)" ); 
+        #else
+        check( rewardsPeriod( ct ) > rewardsPeriod( lastRewardsUpdate ), "already gave rewards within this month" ); 
+        #endif
+    }
+
+    uint32_t misblock::rewardsPeriod( const time_point& t ) const {
+        return t.sec_since_epoch() / rewardsPeriodSeconds;
+    }
+
+    void misblock::payRewards( const name& region, const asset& reward, const vector<name>& hospitals, const vector<uuidType>& reviews ) {
+        hospitalsTable hospitaltable( get_self(), scopeOf( region ) );
+        // 제출 후 정리된 row는 건너뜀
+        for ( const auto& hospital : hospitals ) {
+            auto hitr = hospitaltable.find( hospital.value );
+            if ( hitr == hospitaltable.end() ) continue;
+
+            if ( reward.amount > 0 ) {
+                common::transferToken(get_self(), hitr->owner, reward, "monthly reward");
+            }
+            // 지급한 대상의 weight를 초기화해야함
+            hospitaltable.modify( hitr, get_self(), [&]( HospitalInfo& h ) {
+                h.emrSales = 0;
+                h.reviewVisitors = 0;
+                h.totalReviewsLike = 0;
+                updateWeight( h );
+            });
+        }
+
+        reviewsTable reviewtable( get_self(), get_self().value );
+        customersTable customertable( get_self(), get_self().value );
+
+        int cnt = 0;
+        for ( const auto& reviewId : reviews ) {
+            auto ritr = reviewtable.find( reviewId );
+            // prune된 후기와 이미 보상받은 후기는 지급하지 않음
+            if ( ritr == reviewtable.end() || ritr->isExpired ) continue;
+
+            auto citr = customertable.find( ritr->owner.value );
+            types::pointType rewardPoint = ( 30 - cnt ) * 1000000;
+            types::pointType bonusReward = ( rewardPoint * citr->liveTier( currentMonth(), _cext.pointExpiry ) ) / 100;
+            {
+                misblock::givepointAction givepointAct{ get_self(), { get_self(), name("active") } };
+                givepointAct.send( ritr->owner, rewardPoint + bonusReward, "monthly reward" );
+            }
+            // addPoint( it->owner, rewardPoint );
+            const bool ranked = isRanked( *ritr );
+            reviewtable.modify( ritr, get_self(), [&]( ReviewInfo& r ) {
+                r.isExpired = true;
+                while ( r.likers.begin() != r.likers.end() ) {
+                    auto itr = --r.likers.end();
+                    r.likers.erase( itr );
+                }
+            });
+            updateRanked( ranked, false );
+            cnt++;
+        }
+    }
+
+    name misblock::regionOf( const name& hospital ) {
+        hospdirTable dirtable( get_self(), get_self().value );
+        auto ditr = dirtable.find( hospital.value );
+        return ditr == dirtable.end() ? name() : ditr->region;
+    }
+
+    void misblock::updateWeight( HospitalInfo& h ) {
+        const bool counted = h.region.value_or() == name();
+        const double weight = h.serviceWeight;
+        const bool before = counted && weight >= _cext.hospitalThreshold;
+        h.setWeight();
+        const bool after = counted && h.serviceWeight >= _cext.hospitalThreshold;
+
+        if ( counted && h.serviceWeight != weight ) snapshotRank( h.owner.value, false, weight );
+
+        if ( before && !after ) _cext.hospitalsAbove--;
+        else if ( !before && after ) _cext.hospitalsAbove++;
+    }
+
+    void misblock::updateRanked( const bool& before, const bool& after ) {
+        if ( before && !after ) _cext.reviewsAbove--;
+        else if ( !before && after ) _cext.reviewsAbove++;
+    }
+
+    void misblock::snapshotRank( const uint64_t& key, const bool& isReview, const double& value ) {
+        // 순위가 제출된 동안 처음 바뀌는 row의 바뀌기 전 값을 기록, 이후의 변경은 기록하지 않음
+        if ( _cext.openRankProposal == 0 ) return;
+
+        ranksnapsTable snaptable( get_self(), get_self().value );
+
+        // 이전 제출의 기록은 id가 더 작으므로 앞에서부터 조금씩 정리
+        uint32_t limit = 2;
+        for ( auto it = snaptable.begin(); it != snaptable.end() && it->proposal != _cext.openRankProposal && limit > 0; --limit ) {
+            it = snaptable.erase( it );
+        }
+
+        auto keyIdx = snaptable.get_index<name("bykey")>();
+        if ( keyIdx.find( RankSnapshotInfo::keyOf( _cext.openRankProposal, key, isReview ) ) != keyIdx.end() ) return;
+
+        snaptable.emplace( get_self(), [&]( RankSnapshotInfo& r ) {
+            r.id        = snaptable.available_primary_key();
+            r.proposal  = _cext.openRankProposal;
+            r.key       = key;
+            r.isReview  = isReview;
+            r.value     = value;
+        });
+    }
+
+    double misblock::rankValueAt( const uint64_t& proposal, const uint64_t& key, const bool& isReview, const double& current ) {
+        // 제출 후 바뀌지 않은 row는 현재 값이 제출 시점의 값
+        ranksnapsTable snaptable( get_self(), get_self().value );
+        auto keyIdx = snaptable.get_index<name("bykey")>();
+        auto sitr = keyIdx.find( RankSnapshotInfo::keyOf( proposal, key, isReview ) );
+        return sitr == keyIdx.end() ? current : sitr->value;
+    }
+
+    void misblock::recountRanked() {
+        // 인덱스 상위에서 threshold 아래로 내려가기 전까지만 순회
+        hospitalsTable hospitaltable( get_self(), get_self().value );
+        auto hospitalIdx = hospitaltable.get_index<name("byservice")>();
+
+        _cext.hospitalsAbove = 0;
+        for ( auto it = hospitalIdx.cbegin(); it != hospitalIdx.cend() && it->serviceWeight >= _cext.hospitalThreshold; ++it ) {
+            _cext.hospitalsAbove++;
+        }
+
+        reviewsTable reviewtable( get_self(), get_self().value );
+        auto reviewIdx = reviewtable.get_index<name("byregion")>();
+
+        _cext.reviewsAbove = 0;
+        for ( auto it = reviewIdx.lower_bound( 0 ); it != reviewIdx.cend() && isRanked( *it ); ++it ) {
+            _cext.reviewsAbove++;
+        }
+    }
+
+    void misblock::payconsmis( const name& customer, const uuidType& channelId, const asset& quantity ) {
+        channelsTable channeltable( get_self(), get_self().value );
+        auto chitr = channeltable.find( channelId );
+        check( chitr != channeltable.end(), "channel does not exist" );
+        check( chitr->customer == customer, "invalid channel" );
+        check( currentTimePoint() < chitr->expiresAt, "channel is expired" );
+
+        channeltable.modify( chitr, same_payer, [&]( ChannelInfo& ch ) {
+            ch.deposit += quantity;
+        });
+    }
+
+    void misblock::useLikes( CustomerInfo& c, const time_point& ct, const uint8_t& count ) {
+        // 하루에 세번 좋아요
+        // 하루가 지났으면
+        #ifdef TEST
+        if ( ( ct.sec_since_epoch() / common::secondsPerMinute) > ( c.lastLikeTime.sec_since_epoch() / common::secondsPerMinute ) ) {
+        #else
+        if ( ( ct.sec_since_epoch() / common::secondsPerDay) > ( c.lastLikeTime.sec_since_epoch() / common::secondsPerDay ) ) {
+        #endif
+            check( count <= 3, "there are no remaining likes" );
+            c.remainLike = 3 - count;
+        } else {
+            check( c.remainLike >= count, "there are no remaining likes" );
+            c.remainLike -= count;
+        }
+        c.lastLikeTime = ct;
+    }
+
+    template<typename F>
+    void misblock::bumpRollup( const name& hospital, F update ) {
+        const uint32_t today = currentTimePoint().sec_since_epoch() / common::secondsPerDay;
+        purgeRollups( today, 4 );
+
+        rollupsTable rolluptable( get_self(), today );
+        auto ritr = rolluptable.find( hospital.value );
+        if ( ritr == rolluptable.end() ) {
+            rolluptable.emplace( get_self(), [&]( RollupInfo& r ) {
+                r.hospital = hospital;
+                update( r );
+            });
+        } else {
+            rolluptable.modify( ritr, get_self(), [&]( RollupInfo& r ) {
+                update( r );
+            });
+        }
+    }
+
+    void misblock::purgeRollups( const uint32_t& today, uint32_t limit ) {
+        // 보관 기간이 지난 날의 통계를 쓰기 때마다 조금씩 정리
+        if ( _cext.rollupPurgeDay == 0 ) _cext.rollupPurgeDay = today;
+
+        while ( limit > 0 && _cext.rollupPurgeDay + _cext.rollupRetention <= today ) {
+            rollupsTable rolluptable( get_self(), _cext.rollupPurgeDay );
+            auto ritr = rolluptable.begin();
+            if ( ritr == rolluptable.end() ) {
+                _cext.rollupPurgeDay++;
+            } else {
+                rolluptable.erase( ritr );
+            }
+            limit--;
+        }
+    }
+
+    void misblock::auditPoint( const name& owner, const int64_t& delta ) {
+        if ( _cext.auditPhase == 1 && owner.value < _cext.auditCursor ) {
+            _cext.auditPointSum += delta;
+        }
+    }
+
+    void misblock::auditReview( const name& hospital, const uuidType& reviewId, const int32_t& delta ) {
+        if ( _cext.auditPhase == 2 && hospital.value == _cext.auditCursor && reviewId < _cext.auditSubCursor ) {
+            _cext.auditReviewSum += delta;
+        }
+    }
+
+    void misblock::grantEntitlement( const name& customer, const name& hospital ) {
+        // 같은 병원에 다시 결제하면 만료 시각만 연장
+        const auto expiresAt = currentTimePoint() + eosio::seconds( _cext.entitlementTTL );
+
+        entitlementTable enttable( get_self(), get_self().value );
+        auto pairIdx = enttable.get_index<name("bypair")>();
+        auto eitr = pairIdx.find( ( uint128_t( customer.value ) << 64 ) | hospital.value );
+        if ( eitr == pairIdx.end() ) {
+            enttable.emplace( get_self(), [&]( EntitlementInfo& e ) {
+                e.id        = enttable.available_primary_key();
+                e.customer  = customer;
+                e.hospital  = hospital;
+                e.expiresAt = expiresAt;
+            });
+        } else {
+            pairIdx.modify( eitr, get_self(), [&]( EntitlementInfo& e ) {
+                e.expiresAt = expiresAt;
+            });
+        }
+    }
+
+    void misblock::backfillEntitlements( const CustomerInfo& customer ) {
+        // 자격 row 없이 hospitals에만 남아 있는 병원은 지금부터 TTL만큼 자격 부여, 이미 있는 row는 만료 시각을 유지
+        entitlementTable enttable( get_self(), get_self().value );
+        auto pairIdx = enttable.get_index<name("bypair")>();
+        for ( const auto& hospital : customer.hospitals ) {
+            if ( pairIdx.find( ( uint128_t( customer.owner.value ) << 64 ) | hospital.value ) == pairIdx.end() ) {
+                grantEntitlement( customer.owner, hospital );
+            }
+        }
+    }
+
+    void misblock::revokeEntitlement( const name& customer, const name& hospital ) {
+        entitlementTable enttable( get_self(), get_self().value );
+        auto pairIdx = enttable.get_index<name("bypair")>();
+        auto eitr = pairIdx.find( ( uint128_t( customer.value ) << 64 ) | hospital.value );
+        if ( eitr != pairIdx.end() ) pairIdx.erase( eitr );
+    }
+
+    void misblock::popEntitlements( uint32_t limit ) {
+        const uint64_t now = currentTimePoint().sec_since_epoch();
+
+        entitlementTable enttable( get_self(), get_self().value );
+        customersTable customertable( get_self(), get_self().value );
+        auto expiryIdx = enttable.get_index<name("byexpiry")>();
+
+        for ( auto it = expiryIdx.begin(); it != expiryIdx.end() && it->byExpiry() <= now && limit > 0; --limit ) {
+            auto citr = customertable.find( it->customer.value );
+            if ( citr != customertable.end() ) {
+                customertable.modify( citr, get_self(), [&]( CustomerInfo& c ) {
+                    c.hospitals.erase( it->hospital );
+                });
+            }
+            it = expiryIdx.erase( it );
+        }
+    }
+
+    void misblock::auditMismatch( const uint8_t& kind, const uint64_t& fromKey, const uint64_t& toKey, const int64_t& expected, const int64_t& actual ) {
+        auditlogTable logtable( get_self(), get_self().value );
+        logtable.emplace( get_self(), [&]( AuditLogInfo& l ) {
+            l.id        = logtable.available_primary_key();
+            l.kind      = kind;
+            l.fromKey   = fromKey;
+            l.toKey     = toKey;
+            l.expected  = expected;
+            l.actual    = actual;
+            l.foundAt   = currentTimePoint();
+        });
     }
 
     void misblock::addPoint( const name& owner, const types::pointType& point ) {
@@ -535,26 +1847,104 @@ namespace misblock {
 
         // name payer = !has_auth( owner ) ? get_self() : owner;
         customertable.modify( citr, get_self(), [&]( CustomerInfo& c ) {
-            c.point += point;
-            c.setTier();
+            creditPoint( c, point );
         });
+    }
 
+    void misblock::creditPoint( CustomerInfo& c, const types::pointType& point ) {
+        const uint32_t month = currentMonth();
+        rollVintages();
+        seedBuckets( c, month );
+        c.expirePoints( month, _cext.pointExpiry );
+
+        if ( c.buckets->empty() || c.buckets->back().month != month ) {
+            c.buckets->emplace_back( pointBucket{ month, 0 } );
+        }
+        c.buckets->back().amount += point;
+        c.point += point;
+        c.setTier();
+
+        updateVintage( month, point );
+        auditPoint( c.owner, point );
         _cstate.totalPointSupply += point;
+
+        bumpRollup( name(), [&]( RollupInfo& r ) {
+            r.pointsIssued += point;
+        });
     }
 
     void misblock::subPoint( const name& owner, const types::pointType& point ) {
         customersTable customertable( get_self(), get_self().value );
         const auto& customer = customertable.get( owner.value, "customer does not exist" );
-        check( customer.point >= point, "overdrawn point" );
+
+        const uint32_t month = currentMonth();
+        rollVintages();
 
         // name payer = !has_auth(owner) ? same_payer : owner;
 
         customertable.modify( customer, get_self(), [&]( CustomerInfo& c ) {
+            seedBuckets( c, month );
+            c.expirePoints( month, _cext.pointExpiry );
+            check( c.point >= point, "overdrawn point" );
+
+            // 오래된 포인트부터 차감
+            pointType remain = point;
+            auto it = c.buckets->begin();
+            for ( ; remain > 0 && it != c.buckets->end(); ++it ) {
+                const pointType used = std::min( it->amount, remain );
+                it->amount -= used;
+                remain -= used;
+                updateVintage( it->month, -int64_t( used ) );
+                if ( it->amount > 0 ) break;
+            }
+            // bucket 합계가 point보다 작으면 row가 손상된 것 (audit의 CUSTOMER_BUCKETS)
+            check( remain == 0, "point buckets do not match point" );
+            c.buckets->erase( c.buckets->begin(), it );
+
             c.point -= point;
             c.setTier();
         });
+        auditPoint( owner, -int64_t( point ) );
         _cstate.totalPointSupply -= point;
     }
+
+    void misblock::seedBuckets( CustomerInfo& c, const uint32_t& month ) {
+        // 이전 버전의 잔액은 적립 시점을 알 수 없으므로 현재 달에 적립된 것으로 취급
+        if ( c.buckets.has_value() ) return;
+
+        c.buckets.emplace();
+        if ( c.point > 0 ) {
+            c.buckets->emplace_back( pointBucket{ month, c.point } );
+            updateVintage( month, c.point );
+        }
+    }
+
+    void misblock::rollVintages() {
+        // 소멸 기한이 지난 달의 포인트를 전체 공급량에서 제외, 고객 row는 접근할 때 정리됨
+        const uint32_t month = currentMonth();
+        vintagesTable vintagetable( get_self(), get_self().value );
+        for ( auto it = vintagetable.begin(); it != vintagetable.end() && it->month + _cext.pointExpiry <= month; ) {
+            _cstate.totalPointSupply -= it->amount;
+            _cext.expiredPointSupply += it->amount;
+            it = vintagetable.erase( it );
+        }
+    }
+
+    void misblock::updateVintage( const uint32_t& month, const int64_t& delta ) {
+        vintagesTable vintagetable( get_self(), get_self().value );
+        auto vitr = vintagetable.find( month );
+        if ( vitr == vintagetable.end() ) {
+            check( delta > 0, "point vintage does not exist" );
+            vintagetable.emplace( get_self(), [&]( PointVintageInfo& v ) {
+                v.month     = month;
+                v.amount    = delta;
+            });
+        } else {
+            vintagetable.modify( vitr, get_self(), [&]( PointVintageInfo& v ) {
+                v.amount += delta;
+            });
+        }
+    }
 }
 // code: 실행 계정 명, receiver: 수행 대상 계정 명? (내 생각에는 require_recipient를 받는 리시버를 의미하는 것 같다)
 extern "C" {
@@ -562,7 +1952,7 @@ extern "C" {
         auto self = receiver;
 
         if ( code == self ) switch( action ) {
-            EOSIO_DISPATCH_HELPER( misblock::misblock, (clean)(signup)(setmisratio)(setpubkey)(setlikerwd)(givepoint)(burnpoint)(giverewards)(reghospital)(exchangemis)(postreview)(like)(transferevnt) )
+            EOSIO_DISPATCH_HELPER( misblock::misblock, (clean)(signup)(setmisratio)(setpubkey)(setlikerwd)(setretention)(settitlemode)(setptexpiry)(givepoint)(burnpoint)(giverewards)(setrankcfg)(proposerank)(challenge)(finalrank)(cancelrank)(setemrrptr)(addemrsales)(reghospital)(exchangemis)(postreview)(like)(prune)(settlecash)(withdrawcash)(loadcustomr)(loadhospital)(loadreviews)(openchannel)(settlechan)(refundchan)(setlikekey)(relaylikes)(audit)(setrollupret)(getrollups)(setentttl)(expireents)(migrate)(transferevnt) )
         } else {
             if ( code == name("led.token").value && action == name("transfer").value ) {
                 execute_action( name(receiver), name(code), &misblock::misblock::transferevnt );
@@ -0,0 +1,151 @@
+#pragma once
+
+// hex, base58 코덱, check() 외에는 eosio에 의존하지 않는다
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace common {
+
+static constexpr char hexDigits[] = "0123456789abcdef";
+
+struct hexDecodeTable {
+    int8_t nibble[256];
+    constexpr hexDecodeTable() : nibble() {
+        for (int i = 0; i < 256; ++i) nibble[i] = -1;
+        for (int i = 0; i < 10; ++i) nibble['0' + i] = i;
+        for (int i = 0; i < 6; ++i) nibble['a' + i] = nibble['A' + i] = 10 + i;
+    }
+};
+static constexpr hexDecodeTable hexTable{};
+
+// result에 null 문자를 포함해 len * 2 + 1 바이트가 필요하다
+size_t hexEncode(const uint8_t* input, size_t len, char* result, size_t resultLen) {
+    check(resultLen > len * 2, "hex output buffer too small");
+    for (size_t i = 0; i < len; ++i) {
+        result[i * 2] = hexDigits[input[i] >> 4];
+        result[i * 2 + 1] = hexDigits[input[i] & 0x0f];
+    }
+    result[len * 2] = 0;
+    return len * 2;
+}
+
+size_t hexDecode(const char* input, size_t len, uint8_t* result, size_t resultLen) {
+    check(!(len & 1), "hex string must have an even length");
+    check(resultLen >= len / 2, "hex output buffer too small");
+    for (size_t i = 0; i < len; i += 2) {
+        int8_t hi = hexTable.nibble[uint8_t(input[i])];
+        int8_t lo = hexTable.nibble[uint8_t(input[i + 1])];
+        check(hi >= 0 && lo >= 0, "invalid hex character");
+        result[i / 2] = uint8_t((hi << 4) | lo);
+    }
+    return len / 2;
+}
+
+const char* const ALPHABET =
+    "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+const int8_t ALPHABET_MAP[128] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, 0, 1, 2, 3, 4, 5, 6, 7, 8, -1, -1, -1, -1, -1, -1,
+    -1, 9, 10, 11, 12, 13, 14, 15, 16, -1, 17, 18, 19, 20, 21, -1,
+    22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, -1, -1, -1, -1, -1,
+    -1, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, -1, 44, 45, 46,
+    47, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57, -1, -1, -1, -1, -1};
+
+// 키, 서명, 체크섬 용도이므로 입력 크기를 제한해서 스택 사용량을 고정한다
+static constexpr size_t base58MaxBytes = 128;
+static constexpr size_t base58MaxChars = base58MaxBytes * 138 / 100 + 1;
+// 58^5, 한 limb에 base58 5자리를 담아 내부 루프 횟수를 1/5로 줄인다
+static constexpr uint32_t base58Limb = 656356768;
+
+// result에 null 문자를 포함한 길이가 필요하다
+size_t base58encode(const uint8_t* input, size_t len, char* result, size_t resultLen) {
+    check(len <= base58MaxBytes, "base58 input too long");
+
+    size_t zeros = 0;
+    while (zeros < len && input[zeros] == 0) ++zeros;
+
+    uint32_t limbs[base58MaxChars / 5 + 1];
+    size_t limbsLen = 0;
+    // 3 바이트씩 묶어서 곱한다: limb(< 2^30) * 2^24 + carry 는 64비트를 넘지 않음
+    for (size_t i = zeros; i < len;) {
+        uint64_t carry = 0;
+        uint32_t shift = 0;
+        for (; shift < 24 && i < len; shift += 8, ++i) carry = (carry << 8) | input[i];
+        for (size_t j = 0; j < limbsLen; ++j) {
+            carry += uint64_t(limbs[j]) << shift;
+            limbs[j] = uint32_t(carry % base58Limb);
+            carry /= base58Limb;
+        }
+        while (carry > 0) {
+            limbs[limbsLen++] = uint32_t(carry % base58Limb);
+            carry /= base58Limb;
+        }
+    }
+
+    char top[5];
+    size_t topLen = 0;
+    for (uint32_t v = limbsLen ? limbs[limbsLen - 1] : 0; v > 0; v /= 58) top[topLen++] = ALPHABET[v % 58];
+
+    const size_t outLen = zeros + topLen + (limbsLen ? (limbsLen - 1) * 5 : 0);
+    check(resultLen > outLen, "base58 output buffer too small");
+
+    size_t pos = 0;
+    for (; pos < zeros; ++pos) result[pos] = '1';
+    while (topLen) result[pos++] = top[--topLen];
+    for (size_t j = limbsLen ? limbsLen - 1 : 0; j-- > 0; pos += 5) {
+        uint32_t v = limbs[j];
+        for (int k = 4; k >= 0; --k, v /= 58) result[pos + k] = ALPHABET[v % 58];
+    }
+    result[pos] = 0;
+    return pos;
+}
+
+size_t base58decode(const char* input, size_t len, uint8_t* result, size_t resultLen) {
+    check(len <= base58MaxChars, "base58 input too long");
+
+    size_t zeros = 0;
+    while (zeros < len && input[zeros] == '1') ++zeros;
+
+    uint32_t limbs[base58MaxBytes / 4 + 2];
+    size_t limbsLen = 0;
+    // 5 글자씩 묶어서 2^32 진법 limb에 곱한다
+    for (size_t i = zeros; i < len;) {
+        uint64_t carry = 0;
+        uint64_t mul = 1;
+        for (int k = 0; k < 5 && i < len; ++k, ++i) {
+            uint8_t c = uint8_t(input[i]);
+            int8_t d = c < 128 ? ALPHABET_MAP[c] : -1;
+            check(d >= 0, "invalid base58 character");
+            carry = carry * 58 + d;
+            mul *= 58;
+        }
+        for (size_t j = 0; j < limbsLen; ++j) {
+            carry += uint64_t(limbs[j]) * mul;
+            limbs[j] = uint32_t(carry);
+            carry >>= 32;
+        }
+        while (carry > 0) {
+            check(limbsLen < sizeof(limbs) / sizeof(limbs[0]), "base58 input too long");
+            limbs[limbsLen++] = uint32_t(carry);
+            carry >>= 32;
+        }
+    }
+
+    size_t topLen = 0;
+    for (uint32_t v = limbsLen ? limbs[limbsLen - 1] : 0; v > 0; v >>= 8) ++topLen;
+
+    const size_t outLen = zeros + topLen + (limbsLen ? (limbsLen - 1) * 4 : 0);
+    check(resultLen >= outLen, "base58 output buffer too small");
+
+    size_t pos = 0;
+    for (; pos < zeros; ++pos) result[pos] = 0;
+    while (topLen) result[pos++] = uint8_t(limbs[limbsLen - 1] >> (8 * --topLen));
+    for (size_t j = limbsLen ? limbsLen - 1 : 0; j-- > 0; pos += 4) {
+        for (int k = 0; k < 4; ++k) result[pos + k] = uint8_t(limbs[j] >> (8 * (3 - k)));
+    }
+    return pos;
+}
+}  // namespace common
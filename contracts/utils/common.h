@@ -18,10 +18,13 @@ using namespace std;
 using std::string;
 using std::vector;
 
+// eosio에 의존하지 않으므로 호스트 벤치마크(tests/bench)에서도 그대로 include 한다
+#include "codec.h"
+
 namespace common {
 
 static constexpr uint32_t secondsPerYear = 52 * 7 * 24 * 3600;
-static constexpr uint32_t secondsPerMonth = 31449600;  // secondsPerYear / 12
+static constexpr uint32_t secondsPerMonth = secondsPerYear / 12;  // 2620800, 4주 + 2일 + 8시간
 static constexpr uint32_t secondsPerWeek = 24 * 3600 * 7;
 static constexpr uint32_t secondsPerDay = 24 * 3600;
 static constexpr uint32_t secondsPerHour = 3600;
@@ -103,75 +106,17 @@ string uint64_to_string(const uint64_t& value) {
 
 template <typename CharT>
 static std::string to_hex(const CharT* d, uint32_t s) {
-    std::string r;
-    const char* to_hex = "0123456789abcdef";
-    uint8_t* c = (uint8_t*)d;
-    for (uint32_t i = 0; i < s; ++i) {
-        (r += to_hex[(c[i] >> 4)]) += to_hex[(c[i] & 0x0f)];
-    }
+    std::string r(size_t(s) * 2 + 1, 0);
+    r.resize(hexEncode((const uint8_t*)d, s, &r[0], r.size()));
     return r;
 }
 
 std::string hex_to_string(const std::string& input) {
-    static const char* const lut = "0123456789abcdef";
-    size_t len = input.length();
-    if (len & 1)
-        abort();
-    std::string output;
-    output.reserve(len / 2);
-    for (size_t i = 0; i < len; i += 2) {
-        char a = input[i];
-        const char* p = std::lower_bound(lut, lut + 16, a);
-        if (*p != a)
-            abort();
-        char b = input[i + 1];
-        const char* q = std::lower_bound(lut, lut + 16, b);
-        if (*q != b)
-            abort();
-        output.push_back(((p - lut) << 4) | (q - lut));
-    }
+    std::string output(input.size() / 2, 0);
+    hexDecode(input.data(), input.size(), (uint8_t*)&output[0], output.size());
     return output;
 }
 
-const char* const ALPHABET =
-    "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
-const char ALPHABET_MAP[128] = {
-    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-    -1, 0, 1, 2, 3, 4, 5, 6, 7, 8, -1, -1, -1, -1, -1, -1,
-    -1, 9, 10, 11, 12, 13, 14, 15, 16, -1, 17, 18, 19, 20, 21, -1,
-    22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, -1, -1, -1, -1, -1,
-    -1, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, -1, 44, 45, 46,
-    47, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57, -1, -1, -1, -1, -1};
-
-int base58encode(const std::string input, int len, unsigned char result[]) {
-    unsigned char const* bytes = (unsigned const char*)(input.c_str());
-    unsigned char digits[len * 137 / 100];
-    int digitslen = 1;
-    for (int i = 0; i < len; i++) {
-        unsigned int carry = (unsigned int)bytes[i];
-        for (int j = 0; j < digitslen; j++) {
-            carry += (unsigned int)(digits[j]) << 8;
-            digits[j] = (unsigned char)(carry % 58);
-            carry /= 58;
-        }
-        while (carry > 0) {
-            digits[digitslen++] = (unsigned char)(carry % 58);
-            carry /= 58;
-        }
-    }
-    int resultlen = 0;
-    // leading zero bytes
-    for (; resultlen < len && bytes[resultlen] == 0;)
-        result[resultlen++] = '1';
-    // reverse
-    for (int i = 0; i < digitslen; i++)
-        result[resultlen + i] = ALPHABET[digits[digitslen - 1 - i]];
-    result[digitslen + resultlen] = 0;
-    return digitslen + resultlen;
-}
-
 // 한국시간은 협정 세계시 +9:00
 time_point currentTimePoint() {
     return current_time_point() += microseconds( usecondsPerHour * 9 );
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <optional>
+#include <set>
+
 namespace types {
 enum transferEventActions : uint8_t {
     PAY_WITH_MIS    = 0,
@@ -15,9 +18,32 @@ enum customerTiers : uint8_t {
     DIAMOND     = 25
 };
 
+enum auditMismatches : uint8_t {
+    CUSTOMER_BUCKETS    = 0,    // CustomerInfo::point != sum( buckets )
+    POINT_SUPPLY        = 1,    // sum( live point ) != totalPointSupply
+    REVIEW_COUNT        = 2     // HospitalInfo::reviewCount != 해당 병원의 후기 수
+};
+
 typedef uint64_t uuidType;
 typedef uint64_t pointType;
 
+struct pointBucket {
+    uint32_t    month;      // 적립된 달 (sec_since_epoch / secondsPerMonth)
+    pointType   amount;
+};
+
+struct emrSale {
+    eosio::name     hospital;
+    uint32_t        sales;
+};
+
+struct likeIntent {
+    eosio::name         owner;
+    uuidType            reviewId;
+    uint64_t            nonce;
+    eosio::signature    sig;        // sha256( pack( misblock, owner, reviewId, nonce ) )에 대한 서명
+};
+
 struct transferArgs {
     eosio::name     from;
     eosio::name     to;
@@ -25,6 +51,48 @@ struct transferArgs {
     std::string     memo;
 };
 
+struct cashReceipt {
+    eosio::name     customer;
+    eosio::asset    cost;
+    uuidType        reviewId;   // 후기를 통한 방문이 아니면 nullID
+};
+
+// loadcustomr/loadhospital/loadreviews의 입력 row, 필드 이름은 get table 결과와 같음
+// 테이블 row의 binary_extension은 vector 원소 안에서는 쓸 수 없으므로 이전 버전의 덤프에 없는 필드는 optional (null)
+struct customerRow {
+    eosio::name                                 owner;
+    uint8_t                                     tier;
+    pointType                                   point;
+    std::set<eosio::name>                       hospitals;
+    uint8_t                                     remainLike;
+    eosio::time_point                           lastLikeTime;
+    std::optional< std::vector<pointBucket> >   buckets;
+};
+
+struct hospitalRow {
+    eosio::name                 owner;
+    std::string                 url;
+    double                      serviceWeight;
+    uint32_t                    reviewCount;
+    uint32_t                    emrSales;
+    uint32_t                    reviewVisitors;
+    uint32_t                    totalReviewsLike;
+    std::optional<eosio::name>  region;
+};
+
+struct reviewRow {
+    uuidType                            id;
+    eosio::name                         owner;
+    eosio::name                         hospital;
+    std::set<eosio::name>               likers;
+    bool                                isExpired;
+    int32_t                             likes;
+    std::string                         title;
+    std::optional<eosio::time_point>    postedAt;
+    std::optional<eosio::checksum256>   contentHash;
+    std::optional<eosio::name>          region;
+};
+
 struct eventArgs {
     eosio::name                 from;
     eosio::asset                quantity;
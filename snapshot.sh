@@ -0,0 +1,91 @@
+#!/bin/bash
+# misblock 테이블을 청크 단위로 덤프(export)하거나 다시 적재(import)
+#   ./snapshot.sh export customers ./dump
+#   ./snapshot.sh import customers ./dump
+#
+# 새 체인에 적재할 때는 다음 순서를 지켜야 함
+#   1. configext  설정을 set* 액션으로 다시 적용 (threshold 카운터는 hospitals/reviews 적재 중에 증분 관리)
+#   2. regions    지역 병원을 적재하기 전에 setregion으로 지역을 만듦, hospitalCount는 3에서 다시 셈
+#   3. hospitals  기본 지역(SCOPE=$CONTRACT)과 각 지역(SCOPE=지역 이름)을 모두 적재, hospdir은 여기서 다시 만들어짐
+#   4. customers  vintages와 entitlement는 여기서 다시 만들어지므로 덤프하지 않음
+#   5. reviews    병원의 지역을 찾으므로 hospitals 다음에 적재
+set -eo pipefail
+
+CLEOS=${CLEOS:-"./cleos.sh"}
+CONTRACT=${CONTRACT:-"misblock"}
+CHUNK=${CHUNK:-"100"}
+SCOPE=${SCOPE:-$CONTRACT}
+
+function usage() {
+   printf "Usage: $0 export|import configext|regions|hospitals|customers|reviews DIR
+  env CLEOS     cleos command (Default: ./cleos.sh)
+  env CONTRACT  contract account (Default: misblock)
+  env CHUNK     rows per chunk (Default: 100)
+  env SCOPE     table scope, region name for regional hospitals (Default: \$CONTRACT)
+   \\n" 1>&2
+   exit 1
+}
+
+[[ $# -eq 3 ]] || usage
+
+MODE=$1
+TABLE=$2
+DIR=$3
+
+# 이전 버전의 row에 없는 필드는 load 액션에서 optional이므로 null로 채움
+case $TABLE in
+  configext ) ;;
+  regions )   ;;
+  customers ) ACTION="loadcustomr";  DEFAULTS='{buckets: null}' ;;
+  hospitals ) ACTION="loadhospital"; DEFAULTS='{region: null}' ;;
+  reviews )   ACTION="loadreviews";  DEFAULTS='{postedAt: null, contentHash: null, region: null}' ;;
+  * )         usage ;;
+esac
+
+case $MODE in
+  export )
+    mkdir -p $DIR
+    LOWER=""
+    INDEX=0
+    while true; do
+      # get table은 primary key 오름차순으로 반환하므로 청크는 이미 정렬되어 있음
+      RESULT=$($CLEOS get table $CONTRACT $SCOPE $TABLE -l $CHUNK -L "$LOWER")
+      printf "%s" "$RESULT" | jq -c '{rows: .rows}' > $(printf "%s/%s.%s.%06d.json" $DIR $TABLE $SCOPE $INDEX)
+      INDEX=$((INDEX + 1))
+
+      [[ $(printf "%s" "$RESULT" | jq -r '.more') == true ]] || break
+      LOWER=$(printf "%s" "$RESULT" | jq -r '.next_key')
+    done
+    echo "exported $INDEX chunks of $TABLE to $DIR"
+  ;;
+  import )
+    for FILE in $(ls $DIR/$TABLE.$SCOPE.*.json | sort); do
+      case $TABLE in
+        configext )
+          # configext는 singleton이므로 row 하나, 진행 상태(audit, migrate, 순위 제출)는 옮기지 않음
+          ROW=$(jq -c '.rows[0]' $FILE)
+          $CLEOS push action $CONTRACT setretention "$(printf "%s" "$ROW" | jq -c '[.reviewRetention]')" -p $CONTRACT@active
+          $CLEOS push action $CONTRACT settitlemode "$(printf "%s" "$ROW" | jq -c '[.storeTitle]')" -p $CONTRACT@active
+          $CLEOS push action $CONTRACT setptexpiry "$(printf "%s" "$ROW" | jq -c '[.pointExpiry]')" -p $CONTRACT@active
+          $CLEOS push action $CONTRACT setrankcfg "$(printf "%s" "$ROW" | jq -c '[.rankWorker, .rankChallengeWindow, .hospitalThreshold, .reviewThreshold]')" -p $CONTRACT@active
+          $CLEOS push action $CONTRACT setrollupret "$(printf "%s" "$ROW" | jq -c '[.rollupRetention]')" -p $CONTRACT@active
+          $CLEOS push action $CONTRACT setentttl "$(printf "%s" "$ROW" | jq -c '[.entitlementTTL]')" -p $CONTRACT@active
+          if [[ $(printf "%s" "$ROW" | jq -r '.emrReporter') != "" ]]; then
+            $CLEOS push action $CONTRACT setemrrptr "$(printf "%s" "$ROW" | jq -c '[.emrReporter]')" -p $CONTRACT@active
+          fi
+        ;;
+        regions )
+          jq -c '.rows[] | [.region, .monthlyReward, .rewardPool]' $FILE | while read -r ARGS; do
+            $CLEOS push action $CONTRACT setregion "$ARGS" -p $CONTRACT@active
+          done
+        ;;
+        * )
+          $CLEOS push action $CONTRACT $ACTION "$(jq -c "{rows: [.rows[] | $DEFAULTS + .]}" $FILE)" -p $CONTRACT@active
+        ;;
+      esac
+    done
+  ;;
+  * )
+    usage
+  ;;
+esac
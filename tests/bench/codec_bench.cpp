@@ -0,0 +1,176 @@
+// contracts/utils/codec.h의 hex, base58 코덱을 이전 구현과 비교하는 호스트 벤치마크
+// 키(33), 서명 본문(65), 타입이 붙은 서명(69) 크기의 무작위 입력으로 측정하고, 결과가 이전 구현과 같은지도 검사한다
+//
+// 빌드와 실행 (eosio 없이 호스트 컴파일러만 필요):
+//   g++ -std=c++17 -O2 -o codec_bench tests/bench/codec_bench.cpp
+//   ./codec_bench [iterations]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// 컨트랙트에서는 eosio::check
+void check(bool pred, const char* msg) {
+    if (!pred) throw std::runtime_error(msg);
+}
+
+#include "../../contracts/utils/codec.h"
+
+// 6d93e89 이전의 common.h 구현, digits[0]을 읽기 전에 초기화하지 않던 버그만 고쳤다
+namespace legacy {
+
+template <typename CharT>
+static std::string to_hex(const CharT* d, uint32_t s) {
+    std::string r;
+    const char* to_hex = "0123456789abcdef";
+    uint8_t* c = (uint8_t*)d;
+    for (uint32_t i = 0; i < s; ++i) {
+        (r += to_hex[(c[i] >> 4)]) += to_hex[(c[i] & 0x0f)];
+    }
+    return r;
+}
+
+std::string hex_to_string(const std::string& input) {
+    static const char* const lut = "0123456789abcdef";
+    size_t len = input.length();
+    if (len & 1)
+        abort();
+    std::string output;
+    output.reserve(len / 2);
+    for (size_t i = 0; i < len; i += 2) {
+        char a = input[i];
+        const char* p = std::lower_bound(lut, lut + 16, a);
+        if (*p != a)
+            abort();
+        char b = input[i + 1];
+        const char* q = std::lower_bound(lut, lut + 16, b);
+        if (*q != b)
+            abort();
+        output.push_back(((p - lut) << 4) | (q - lut));
+    }
+    return output;
+}
+
+int base58encode(const std::string input, int len, unsigned char result[]) {
+    unsigned char const* bytes = (unsigned const char*)(input.c_str());
+    std::vector<unsigned char> digits(len * 137 / 100 + 1, 0);
+    int digitslen = 1;
+    for (int i = 0; i < len; i++) {
+        unsigned int carry = (unsigned int)bytes[i];
+        for (int j = 0; j < digitslen; j++) {
+            carry += (unsigned int)(digits[j]) << 8;
+            digits[j] = (unsigned char)(carry % 58);
+            carry /= 58;
+        }
+        while (carry > 0) {
+            digits[digitslen++] = (unsigned char)(carry % 58);
+            carry /= 58;
+        }
+    }
+    int resultlen = 0;
+    // leading zero bytes
+    for (; resultlen < len && bytes[resultlen] == 0;)
+        result[resultlen++] = '1';
+    // reverse
+    for (int i = 0; i < digitslen; i++)
+        result[resultlen + i] = common::ALPHABET[digits[digitslen - 1 - i]];
+    result[digitslen + resultlen] = 0;
+    return digitslen + resultlen;
+}
+
+}  // namespace legacy
+
+// 최적화로 결과가 버려지지 않도록 누적
+static volatile size_t sink = 0;
+
+template <typename F>
+static double nsPerOp(size_t iterations, F func) {
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) sink = sink + func(i);
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+static void report(const char* name, size_t bytes, double before, double after) {
+    if (before > 0)
+        printf("%-16s %3zu B  old %8.1f ns  new %8.1f ns  x%.1f\n", name, bytes, before, after, before / after);
+    else
+        printf("%-16s %3zu B  old %8s     new %8.1f ns\n", name, bytes, "-", after);
+}
+
+int main(int argc, char** argv) {
+    const size_t iterations = argc > 1 ? strtoull(argv[1], nullptr, 10) : 200000;
+    const size_t pool = 256;
+
+    std::mt19937_64 rng(58);
+    for (size_t bytes : {33, 65, 69}) {
+        // 입력마다 선행 0 바이트의 수를 다르게 해서 '1' 접두사 경로도 측정
+        std::vector<std::string> inputs(pool);
+        for (size_t n = 0; n < pool; ++n) {
+            inputs[n].resize(bytes);
+            for (auto& c : inputs[n]) c = char(rng());
+            for (size_t z = 0; z < n % 3; ++z) inputs[n][z] = 0;
+        }
+
+        std::vector<std::string> hexes(pool), b58s(pool);
+        for (size_t n = 0; n < pool; ++n) {
+            const auto* in = (const uint8_t*)inputs[n].data();
+
+            char hex[2 * 128 + 1];
+            common::hexEncode(in, bytes, hex, sizeof(hex));
+            hexes[n] = hex;
+            check(hexes[n] == legacy::to_hex(inputs[n].data(), bytes), "hex encode differs from legacy");
+
+            uint8_t raw[128];
+            check(common::hexDecode(hex, hexes[n].size(), raw, sizeof(raw)) == bytes, "hex decode length");
+            check(std::string((const char*)raw, bytes) == inputs[n], "hex round trip");
+
+            char b58[common::base58MaxChars + 1];
+            unsigned char legacyB58[common::base58MaxChars + 1];
+            common::base58encode(in, bytes, b58, sizeof(b58));
+            legacy::base58encode(inputs[n], bytes, legacyB58);
+            b58s[n] = b58;
+            check(b58s[n] == (const char*)legacyB58, "base58 encode differs from legacy");
+
+            check(common::base58decode(b58, b58s[n].size(), raw, sizeof(raw)) == bytes, "base58 decode length");
+            check(std::string((const char*)raw, bytes) == inputs[n], "base58 round trip");
+        }
+
+        report("hex encode", bytes,
+               nsPerOp(iterations, [&](size_t i) { return legacy::to_hex(inputs[i % pool].data(), bytes).size(); }),
+               nsPerOp(iterations, [&](size_t i) {
+                   char hex[2 * 128 + 1];
+                   return common::hexEncode((const uint8_t*)inputs[i % pool].data(), bytes, hex, sizeof(hex));
+               }));
+
+        report("hex decode", bytes,
+               nsPerOp(iterations, [&](size_t i) { return legacy::hex_to_string(hexes[i % pool]).size(); }),
+               nsPerOp(iterations, [&](size_t i) {
+                   uint8_t raw[128];
+                   return common::hexDecode(hexes[i % pool].data(), hexes[i % pool].size(), raw, sizeof(raw));
+               }));
+
+        report("base58 encode", bytes,
+               nsPerOp(iterations, [&](size_t i) {
+                   unsigned char b58[common::base58MaxChars + 1];
+                   return size_t(legacy::base58encode(inputs[i % pool], bytes, b58));
+               }),
+               nsPerOp(iterations, [&](size_t i) {
+                   char b58[common::base58MaxChars + 1];
+                   return common::base58encode((const uint8_t*)inputs[i % pool].data(), bytes, b58, sizeof(b58));
+               }));
+
+        // 이전 구현에는 base58 decode가 없었음
+        report("base58 decode", bytes, 0,
+               nsPerOp(iterations, [&](size_t i) {
+                   uint8_t raw[128];
+                   return common::base58decode(b58s[i % pool].data(), b58s[i % pool].size(), raw, sizeof(raw));
+               }));
+    }
+    return 0;
+}
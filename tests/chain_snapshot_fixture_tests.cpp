@@ -0,0 +1,23 @@
+#include <boost/test/unit_test.hpp>
+
+#include "misblock_tester.hpp"
+
+using namespace mib_test;
+
+// ctest의 FIXTURES_SETUP 단계, 다른 suite보다 먼저 한 번만 실행되어 populate()한 상태를 MIB_TEST_SNAPSHOT에 저장
+BOOST_AUTO_TEST_SUITE(chain_snapshot_fixture)
+
+BOOST_AUTO_TEST_CASE( write_snapshot ) try {
+   const char* path = getenv( snapshotEnv );
+   BOOST_REQUIRE_MESSAGE( path != nullptr, "MIB_TEST_SNAPSHOT is not set, run this suite through ctest" );
+
+   misblock_tester chain( misblock_tester::source::fresh );
+   chain.writeSnapshot( path );
+
+   // 저장한 상태가 복원되는지 확인
+   misblock_tester restored;
+   BOOST_REQUIRE_EQUAL( 1, restored.getReview( 1 )["likes"].as<int32_t>() );
+   BOOST_REQUIRE_EQUAL( 1, restored.getHospital( N(hospital1) )["reviewCount"].as<uint32_t>() );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
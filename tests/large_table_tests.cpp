@@ -0,0 +1,179 @@
+#include <boost/test/unit_test.hpp>
+
+#include "misblock_tester.hpp"
+
+using namespace mib_test;
+
+namespace {
+
+class large_tester : public misblock_tester {
+public:
+   // phase가 0으로 돌아올 때까지 limit개 씩 audit, 호출한 횟수를 반환
+   uint32_t auditAll( uint32_t limit ) {
+      uint32_t pages = 0;
+      do {
+         BOOST_REQUIRE_EQUAL( success(), act( N(misblock), N(audit), mvo()( "limit", limit ) ) );
+         produce_block();
+         ++pages;
+      } while ( getConfigExt()["auditPhase"].as<uint32_t>() != 0 );
+      return pages;
+   }
+
+   // "nothing to prune"이 될 때까지 limit개 씩 prune, 정리한 호출 횟수를 반환
+   uint32_t pruneAll( uint32_t limit, bool archive ) {
+      uint32_t pages = 0;
+      while ( true ) {
+         auto result = act( N(misblock), N(prune), mvo()( "limit", limit )( "archive", archive ) );
+         produce_block();
+         if ( result != success() ) {
+            BOOST_REQUIRE_EQUAL( wasm_assert_msg( "nothing to prune" ), result );
+            return pages;
+         }
+         ++pages;
+      }
+   }
+
+   action_result giverewards( const string& region ) {
+      auto result = act( N(misblock), N(giverewards), mvo()( "region", region ) );
+      produce_block();
+      return result;
+   }
+
+   fc::variant getRegion( const name& region ) {
+      return getRow( N(regions), "RegionInfo", region.value );
+   }
+
+   // byservice 인덱스 순서 (weight 내림차순, 같으면 owner 오름차순)의 지역 병원
+   vector<name> regionalRanking( const name& region ) {
+      vector<pair<double, name>> weights;
+      for ( uint32_t i = 0; i < 2 * regionalHospitals; ++i ) {
+         const auto hospital = largeHospital( i );
+         auto row = getRow( N(hospitals), "HospitalInfo", hospital.value, region );
+         if ( !row.is_null() ) weights.emplace_back( row["serviceWeight"].as<double>(), hospital );
+      }
+      std::sort( weights.begin(), weights.end(), []( const auto& a, const auto& b ) {
+         return a.first > b.first || ( a.first == b.first && a.second.value < b.second.value );
+      });
+      vector<name> ranking;
+      for ( const auto& w : weights ) ranking.push_back( w.second );
+      return ranking;
+   }
+};
+
+}  // namespace
+
+// populateLarge()로 적재한 수천 개의 row를 대상으로 페이지 단위로 나눠 처리하는 경로
+BOOST_AUTO_TEST_SUITE(large_table_tests)
+
+BOOST_FIXTURE_TEST_CASE( restored_large_state, large_tester ) try {
+   BOOST_REQUIRE_EQUAL( largeCustomers + 2, countRows( N(customers) ) );
+   BOOST_REQUIRE_EQUAL( largeReviews + 1, countRows( N(reviews) ) );
+   BOOST_REQUIRE_EQUAL( regionalHospitals, countRows( N(hospitals), N(seoul) ) );
+   BOOST_REQUIRE_EQUAL( regionalHospitals, countRows( N(hospitals), N(busan) ) );
+   BOOST_REQUIRE_EQUAL( 2 * regionalHospitals, countRows( N(hospdir) ) );
+   BOOST_REQUIRE_EQUAL( regionalHospitals, getRegion( N(seoul) )["hospitalCount"].as<uint32_t>() );
+
+   // loadcustomr가 hospitals의 자격을 다시 만들었음 (bob의 자격 포함)
+   BOOST_REQUIRE_EQUAL( largeCustomers / 10 + 1, countRows( N(entitlement) ) );
+
+   // 덤프에 없던 필드는 적재할 때 채워짐
+   auto review = getReview( largeReviewBase + 1 );
+   BOOST_REQUIRE_EQUAL( "seoul", review["region"].as_string() );
+   BOOST_REQUIRE_EQUAL( 63, getRow( N(hospitals), "HospitalInfo", N(seoulb).value, N(seoul) )["reviewCount"].as<uint32_t>() );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( audit_pages, large_tester ) try {
+   // 고객 2000명과 후기 3000개를 100개 씩 나눠서 검사
+   const uint32_t pages = auditAll( 100 );
+   BOOST_REQUIRE_GT( pages, ( largeCustomers + largeReviews ) / 100 );
+   BOOST_REQUIRE_EQUAL( 0, countRows( N(auditlog) ) );
+
+   // 후기 수가 맞지 않는 병원을 적재하면 다음 audit에서 발견
+   BOOST_REQUIRE_EQUAL( success(), act( N(misblock), N(loadhospital), mvo()( "rows", fc::variants{ mvo()
+      ( "owner", "seouly" )
+      ( "url", "https://seouly.example" )
+      ( "serviceWeight", 0 )
+      ( "reviewCount", 5 )
+      ( "emrSales", 0 )
+      ( "reviewVisitors", 0 )
+      ( "totalReviewsLike", 0 )
+      ( "region", "seoul" ) } ) ) );
+   produce_block();
+
+   auditAll( 500 );
+   BOOST_REQUIRE_EQUAL( 1, countRows( N(auditlog) ) );
+   auto mismatch = getRow( N(auditlog), "AuditLogInfo", 0 );
+   BOOST_REQUIRE_EQUAL( 2, mismatch["kind"].as<uint32_t>() );  // REVIEW_COUNT
+   BOOST_REQUIRE_EQUAL( N(seouly).value, mismatch["fromKey"].as_uint64() );
+   BOOST_REQUIRE_EQUAL( 5, mismatch["expected"].as_int64() );
+   BOOST_REQUIRE_EQUAL( 0, mismatch["actual"].as_int64() );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( audit_resumes_across_prune, large_tester ) try {
+   // 병원 별 후기 수를 세는 중간에 후기를 정리해도 이어서 검사한 결과가 맞아야 함
+   do {
+      BOOST_REQUIRE_EQUAL( success(), act( N(misblock), N(audit), mvo()( "limit", 50 ) ) );
+      produce_block();
+   } while ( getConfigExt()["auditPhase"].as<uint32_t>() != 2 || getConfigExt()["auditRegion"].as_string() != "seoul" );
+
+   BOOST_REQUIRE_EQUAL( 10, pruneAll( 100, false ) );
+   auditAll( 50 );
+   BOOST_REQUIRE_EQUAL( 0, countRows( N(auditlog) ) );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( prune, large_tester ) try {
+   // 3개 중 1개(1000개)가 보관 기간이 지났음, 300개는 삭제하고 나머지는 요약본을 남김
+   BOOST_REQUIRE_EQUAL( success(), act( N(misblock), N(prune), mvo()( "limit", 300 )( "archive", false ) ) );
+   produce_block();
+   BOOST_REQUIRE_EQUAL( 7, pruneAll( 100, true ) );
+
+   BOOST_REQUIRE_EQUAL( largeReviews + 1 - 1000, countRows( N(reviews) ) );
+   BOOST_REQUIRE_EQUAL( 700, countRows( N(archives) ) );
+   BOOST_REQUIRE( getReview( largeReviewBase + 2997 ).is_null() );
+   BOOST_REQUIRE( !getReview( largeReviewBase + 2998 ).is_null() );
+   BOOST_REQUIRE( !getReview( 1 ).is_null() );
+
+   // seoula의 후기(id % 48 == 0)는 모두 보관 기간이 지났고 seoulb의 후기는 하나도 지나지 않았음
+   BOOST_REQUIRE_EQUAL( 0, getRow( N(hospitals), "HospitalInfo", N(seoula).value, N(seoul) )["reviewCount"].as<uint32_t>() );
+   BOOST_REQUIRE_EQUAL( 63, getRow( N(hospitals), "HospitalInfo", N(seoulb).value, N(seoul) )["reviewCount"].as<uint32_t>() );
+
+   auditAll( 500 );
+   BOOST_REQUIRE_EQUAL( 0, countRows( N(auditlog) ) );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( giverewards_regions, large_tester ) try {
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "region does not exist" ), giverewards( "daegu" ) );
+
+   produceToNextPeriod();
+   const auto ranking = regionalRanking( N(seoul) );
+   BOOST_REQUIRE_EQUAL( regionalHospitals, ranking.size() );
+   vector<asset> before;
+   for ( const auto& hospital : ranking ) before.push_back( getBalance( hospital ) );
+   const auto reviewerPoint = getCustomer( largeCustomer( 0 ) )["point"].as_uint64();
+
+   // 예산 1000 MIS로는 상위 16개 중 10개까지만 100 MIS씩 지급
+   BOOST_REQUIRE_EQUAL( success(), giverewards( "seoul" ) );
+   for ( size_t i = 0; i < ranking.size(); ++i ) {
+      const asset paid = asset::from_string( i < 10 ? "100.0000 MIS" : "0.0000 MIS" );
+      BOOST_REQUIRE_EQUAL( before[i] + paid, getBalance( ranking[i] ) );
+   }
+   BOOST_REQUIRE_EQUAL( "0.0000 MIS", getRegion( N(seoul) )["rewardPool"].as_string() );
+
+   // 좋아요 100개 이상인 seoul 후기 24개(id 0..23) 중 상위 16개에 포인트 지급
+   BOOST_REQUIRE( getReview( largeReviewBase + 15 )["isExpired"].as_bool() );
+   BOOST_REQUIRE( !getReview( largeReviewBase + 16 )["isExpired"].as_bool() );
+   BOOST_REQUIRE_GT( getCustomer( largeCustomer( 0 ) )["point"].as_uint64(), reviewerPoint );
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "already gave rewards within this minute(test)" ), giverewards( "seoul" ) );
+   BOOST_REQUIRE_EQUAL( success(), giverewards( "busan" ) );
+   BOOST_REQUIRE_EQUAL( "0.0000 MIS", getRegion( N(busan) )["rewardPool"].as_string() );
+
+   // 예산이 없으면 병원은 지급하지 않고 남은 후기만 지급
+   produceToNextPeriod();
+   const asset unpaid = getBalance( ranking[10] );
+   BOOST_REQUIRE_EQUAL( success(), giverewards( "seoul" ) );
+   BOOST_REQUIRE_EQUAL( unpaid, getBalance( ranking[10] ) );
+   BOOST_REQUIRE( getReview( largeReviewBase + 23 )["isExpired"].as_bool() );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,336 @@
+#pragma once
+
+#include <eosio/chain/abi_serializer.hpp>
+#include <eosio/chain/snapshot.hpp>
+#include <eosio/testing/tester.hpp>
+
+#include <fc/variant_object.hpp>
+
+#include <cstdlib>
+#include <fstream>
+
+#include "contracts.hpp"
+
+using namespace eosio::chain;
+using namespace eosio::testing;
+using namespace fc;
+using namespace std;
+
+using mvo = fc::mutable_variant_object;
+
+namespace mib_test {
+
+// 모든 suite가 공유하는 체인 상태의 경로, ctest가 chain_snapshot_fixture와 각 suite에 같은 값을 넘겨줌
+static const char* snapshotEnv = "MIB_TEST_SNAPSHOT";
+
+// misblock.cpp의 rewardsPeriodSeconds (TEST 빌드)
+static constexpr uint32_t rewardsPeriodSeconds = 60;
+// common::secondsPerMonth, bucket의 month 계산에 사용
+static constexpr uint32_t secondsPerMonth = 52 * 7 * 24 * 3600 / 12;
+
+// populateLarge()가 적재하는 대량 상태의 크기
+static constexpr uint32_t largeCustomers = 2000;            // user + 4글자 (useraaaa, useraaab, ...)
+static constexpr uint32_t largeReviews = 3000;              // id largeReviewBase부터
+static constexpr uint64_t largeReviewBase = 10000;
+static constexpr uint32_t regionalHospitals = 24;           // 지역 별 병원 수 (seoula..seoulx, busana..busanx)
+static constexpr uint32_t largeRankedReviews = 40;          // 좋아요 100개 이상인 후기, 앞쪽 id
+
+// populate()가 만드는 상태
+//   계정: led.token, misblock, alice, bob, hospital1 (모두 eosio.code 권한 포함)
+//   led.token: MIS 발행, alice/bob에게 1000 MIS, misblock에게 100000 MIS
+//   misblock: alice/bob 가입, hospital1 등록 (기본 region)
+//             alice와 bob이 hospital1에 10 MIS씩 결제, alice가 후기 1을 작성하고 bob이 좋아요
+//             bob은 후기를 쓸 수 있는 자격이 남아 있음
+//   대량 상태(populateLarge): 지역 seoul/busan과 각 지역 병원 24개
+//             고객 2000명을 loadcustomr로 적재 (이번 달과 지난 달 bucket, 10명 중 1명은 지역 병원 자격)
+//             지역 병원 후기 3000개를 loadreviews로 적재, 3개 중 1개는 보관 기간이 지났음
+//             기본 지역에는 추가하지 않으므로 기본 지역 순위(rank_tests)에는 영향이 없음
+class misblock_tester : public base_tester {
+public:
+    enum class source { snapshot, fresh };
+
+    // snapshot: MIB_TEST_SNAPSHOT의 상태를 복원, 파일이 없으면(ctest 밖에서 실행) 직접 만든다
+    // fresh: 새 체인에 populate(), chain_snapshot_fixture만 사용
+    explicit misblock_tester( source from = source::snapshot ) {
+        const char* path = getenv( snapshotEnv );
+        if ( from == source::snapshot && path && fc::exists( path ) ) {
+            std::ifstream in( path, std::ios::in | std::ios::binary );
+            BOOST_REQUIRE_MESSAGE( in.good(), string( "cannot open snapshot " ) + path );
+            init( snapshotConfig(), std::make_shared<istream_snapshot_reader>( in ) );
+        } else {
+            init( setup_policy::full );
+            populate();
+        }
+
+        const auto* accnt = control->db().find<account_object, by_name>( N(misblock) );
+        BOOST_REQUIRE( accnt != nullptr );
+        abi_def abi;
+        BOOST_REQUIRE_EQUAL( abi_serializer::to_abi( accnt->abi, abi ), true );
+        abi_ser.set_abi( abi, abi_serializer_max_time );
+    }
+
+    signed_block_ptr produce_block( fc::microseconds skip_time = fc::milliseconds(config::block_interval_ms) ) override {
+        return _produce_block( skip_time, false );
+    }
+
+    signed_block_ptr produce_empty_block( fc::microseconds skip_time = fc::milliseconds(config::block_interval_ms) ) override {
+        control->abort_block();
+        return _produce_block( skip_time, true );
+    }
+
+    signed_block_ptr finish_block() override {
+        return _finish_block();
+    }
+
+    bool validate() { return true; }
+
+    // 다음 보상 기간이 시작되는 시각에 블록을 만듦, 이후 액션은 새 기간의 시작에서 실행됨
+    // 컨트랙트는 TEST로 빌드되므로 보상 기간은 1분
+    void produceToNextPeriod() {
+        const uint32_t now = control->head_block_time().sec_since_epoch();
+        produce_block( fc::seconds( rewardsPeriodSeconds - now % rewardsPeriodSeconds ) );
+    }
+
+    // 현재 상태를 snapshot으로 저장, 다른 suite가 중간에 읽지 않도록 임시 파일에 쓴 후 이름을 바꾼다
+    void writeSnapshot( const string& path ) {
+        produce_block();
+        control->abort_block();
+
+        const string tmp = path + ".tmp";
+        {
+            std::ofstream out( tmp, std::ios::out | std::ios::binary | std::ios::trunc );
+            auto writer = std::make_shared<ostream_snapshot_writer>( out );
+            control->write_snapshot( writer );
+            writer->finalize();
+            out.flush();
+            BOOST_REQUIRE_MESSAGE( out.good(), "failed to write snapshot " + tmp );
+        }
+        fc::rename( tmp, path );
+    }
+
+    action_result act( const account_name& signer, const action_name& name, const variant_object& data ) {
+        action a;
+        a.account = N(misblock);
+        a.name    = name;
+        a.data    = abi_ser.variant_to_binary( abi_ser.get_action_type( name ), data, abi_serializer_max_time );
+        return base_tester::push_action( std::move( a ), uint64_t( signer ) );
+    }
+
+    action_result transfer( const account_name& from, const account_name& to, const string& quantity, const string& memo ) {
+        try {
+            base_tester::push_action( N(led.token), N(transfer), from, mvo()
+                ( "from", from )
+                ( "to", to )
+                ( "quantity", quantity )
+                ( "memo", memo ) );
+        } catch ( const fc::exception& e ) {
+            return error( e.top_message() );
+        }
+        return success();
+    }
+
+    fc::variant getRow( const name& table, const string& type, uint64_t key, const name& scope = N(misblock) ) {
+        vector<char> data = get_row_by_account( N(misblock), scope, table, key );
+        return data.empty() ? fc::variant() : abi_ser.binary_to_variant( type, data, abi_serializer_max_time );
+    }
+
+    fc::variant getCustomer( const name& owner ) {
+        return getRow( N(customers), "CustomerInfo", owner.value );
+    }
+
+    fc::variant getHospital( const name& owner ) {
+        return getRow( N(hospitals), "HospitalInfo", owner.value );
+    }
+
+    fc::variant getReview( uint64_t id ) {
+        return getRow( N(reviews), "ReviewInfo", id );
+    }
+
+    fc::variant getConfigExt() {
+        return getRow( N(configext), "ConfigExtInfo", N(configext).value );
+    }
+
+    // scope의 table에 있는 row 수
+    uint32_t countRows( const name& table, const name& scope = N(misblock) ) {
+        const auto* t = control->db().find<table_id_object, by_code_scope_table>( boost::make_tuple( N(misblock), scope, table ) );
+        return t == nullptr ? 0 : t->count;
+    }
+
+    // populateLarge()의 계정 이름, prefix 뒤에 i를 digits 자리의 a-z로 붙이므로 i 순서와 이름 순서가 같음
+    static name largeName( const string& prefix, uint32_t i, int digits ) {
+        string tail( digits, 'a' );
+        for ( int d = digits - 1; d >= 0; --d, i /= 26 ) tail[d] = 'a' + i % 26;
+        return name( prefix + tail );
+    }
+
+    static name largeCustomer( uint32_t i ) { return largeName( "user", i, 4 ); }
+    static name largeHospital( uint32_t i ) { return largeName( i < regionalHospitals ? "seoul" : "busan", i % regionalHospitals, 1 ); }
+
+    fc::variant getCashDeposit( const name& hospital ) {
+        return getRow( N(cashdeposit), "CashDepositInfo", hospital.value );
+    }
+
+    asset getBalance( const name& owner ) {
+        return get_currency_balance( N(led.token), symbol( SY(4, MIS) ), owner );
+    }
+
+    abi_serializer abi_ser;
+
+private:
+    controller::config snapshotConfig() {
+        controller::config cfg;
+        cfg.blocks_dir             = tempdir.path() / config::default_blocks_dir_name;
+        cfg.state_dir              = tempdir.path() / config::default_state_dir_name;
+        cfg.state_size             = 1024*1024*64;
+        cfg.state_guard_size       = 0;
+        cfg.reversible_cache_size  = 1024*1024*8;
+        cfg.reversible_guard_size  = 0;
+        cfg.contracts_console      = true;
+        cfg.genesis.initial_timestamp = fc::time_point::from_iso_string( "2020-01-01T00:00:00.000" );
+        cfg.genesis.initial_key       = get_public_key( config::system_account_name, "active" );
+        return cfg;
+    }
+
+    void populate() {
+        create_accounts( { N(led.token), N(misblock), N(alice), N(bob), N(hospital1) } );
+        produce_block();
+
+        set_code( N(led.token), contracts::token_wasm() );
+        set_abi( N(led.token), contracts::token_abi().data() );
+        set_code( N(misblock), contracts::misblock_wasm() );
+        set_abi( N(misblock), contracts::misblock_abi().data() );
+        produce_block();
+
+        base_tester::push_action( N(led.token), N(create), N(led.token), mvo()
+            ( "issuer", "led.token" )
+            ( "maximum_supply", "1000000000.0000 MIS" ) );
+        base_tester::push_action( N(led.token), N(issue), N(led.token), mvo()
+            ( "to", "led.token" )
+            ( "quantity", "102000.0000 MIS" )
+            ( "memo", "" ) );
+        base_tester::push_action( N(led.token), N(transfer), N(led.token), mvo()
+            ( "from", "led.token" )( "to", "alice" )( "quantity", "1000.0000 MIS" )( "memo", "" ) );
+        base_tester::push_action( N(led.token), N(transfer), N(led.token), mvo()
+            ( "from", "led.token" )( "to", "bob" )( "quantity", "1000.0000 MIS" )( "memo", "" ) );
+        base_tester::push_action( N(led.token), N(transfer), N(led.token), mvo()
+            ( "from", "led.token" )( "to", "misblock" )( "quantity", "100000.0000 MIS" )( "memo", "" ) );
+        produce_block();
+
+        base_tester::push_action( N(misblock), N(signup), N(misblock), mvo()( "owner", "alice" ) );
+        base_tester::push_action( N(misblock), N(signup), N(misblock), mvo()( "owner", "bob" ) );
+        base_tester::push_action( N(misblock), N(reghospital), N(misblock), mvo()
+            ( "owner", "hospital1" )
+            ( "url", "https://hospital1.example" )
+            ( "region", "" ) );
+        produce_block();
+
+        base_tester::push_action( N(led.token), N(transfer), N(alice), mvo()
+            ( "from", "alice" )( "to", "misblock" )( "quantity", "10.0000 MIS" )( "memo", "paybillmis:hospital1" ) );
+        base_tester::push_action( N(led.token), N(transfer), N(bob), mvo()
+            ( "from", "bob" )( "to", "misblock" )( "quantity", "10.0000 MIS" )( "memo", "paybillmis:hospital1" ) );
+        produce_block();
+
+        base_tester::push_action( N(misblock), N(postreview), N(alice), mvo()
+            ( "owner", "alice" )
+            ( "hospital", "hospital1" )
+            ( "reviewId", 1 )
+            ( "title", "kind doctors" )
+            ( "reviewJson", "{\"rating\":5}" ) );
+        produce_block();
+
+        base_tester::push_action( N(misblock), N(like), N(bob), mvo()
+            ( "owner", "bob" )
+            ( "reviewId", 1 ) );
+        produce_block();
+
+        populateLarge();
+    }
+
+    void populateLarge() {
+        const uint32_t hospitalCount = 2 * regionalHospitals;
+        vector<account_name> hospitals;
+        for ( uint32_t i = 0; i < hospitalCount; ++i ) hospitals.emplace_back( largeHospital( i ) );
+        create_accounts( hospitals );
+        produce_block();
+
+        for ( const auto& region : { "seoul", "busan" } ) {
+            base_tester::push_action( N(misblock), N(setregion), N(misblock), mvo()
+                ( "region", region )
+                ( "monthlyReward", "100.0000 MIS" )
+                ( "rewardPool", "1000.0000 MIS" ) );
+        }
+        produce_block();
+
+        const auto now = control->head_block_time();
+        const uint32_t month = now.sec_since_epoch() / secondsPerMonth;
+
+        // 후기 i: 작성자 i번째 고객, 병원 i % 48, 앞쪽 40개만 좋아요 100개 이상
+        auto likesOf = []( uint32_t i ) { return i < largeRankedReviews ? int32_t( 200 - i ) : int32_t( i % 90 ); };
+        vector<uint32_t> reviewCount( hospitalCount, 0 );
+        vector<uint32_t> totalLikes( hospitalCount, 0 );
+        for ( uint32_t i = 0; i < largeReviews; ++i ) {
+            reviewCount[i % hospitalCount]++;
+            totalLikes[i % hospitalCount] += likesOf( i );
+        }
+
+        // 병원은 이름 순서대로 적재해야 하므로 지역 별로 한 청크
+        for ( uint32_t first : { 0u, regionalHospitals } ) {
+            fc::variants rows;
+            for ( uint32_t i = first; i < first + regionalHospitals; ++i ) {
+                rows.push_back( mvo()
+                    ( "owner", largeHospital( i ) )
+                    ( "url", "https://" + largeHospital( i ).to_string() + ".example" )
+                    ( "serviceWeight", 0 )
+                    ( "reviewCount", reviewCount[i] )
+                    ( "emrSales", 0 )
+                    ( "reviewVisitors", 0 )
+                    ( "totalReviewsLike", totalLikes[i] )
+                    ( "region", i < regionalHospitals ? "seoul" : "busan" ) );
+            }
+            base_tester::push_action( N(misblock), N(loadhospital), N(misblock), mvo()( "rows", rows ) );
+        }
+        produce_block();
+
+        for ( uint32_t first = 0; first < largeCustomers; first += 100 ) {
+            fc::variants rows;
+            for ( uint32_t i = first; i < first + 100; ++i ) {
+                fc::variants entitled;
+                if ( i % 10 == 0 ) entitled.emplace_back( largeHospital( i % hospitalCount ) );
+                rows.push_back( mvo()
+                    ( "owner", largeCustomer( i ) )
+                    ( "tier", 0 )
+                    ( "point", 3000000 + i )
+                    ( "hospitals", entitled )
+                    ( "remainLike", 3 )
+                    ( "lastLikeTime", fc::time_point() )
+                    ( "buckets", fc::variants{
+                        mvo()( "month", month - 1 )( "amount", 1000000 ),
+                        mvo()( "month", month )( "amount", 2000000 + i ) } ) );
+            }
+            base_tester::push_action( N(misblock), N(loadcustomr), N(misblock), mvo()( "rows", rows ) );
+            produce_block();
+        }
+
+        const auto stale = now - fc::days( 2 * 365 );
+        for ( uint32_t first = 0; first < largeReviews; first += 100 ) {
+            fc::variants rows;
+            for ( uint32_t i = first; i < first + 100; ++i ) {
+                rows.push_back( mvo()
+                    ( "id", largeReviewBase + i )
+                    ( "owner", largeCustomer( i % largeCustomers ) )
+                    ( "hospital", largeHospital( i % hospitalCount ) )
+                    ( "likers", fc::variants() )
+                    ( "isExpired", false )
+                    ( "likes", likesOf( i ) )
+                    ( "title", "review " + std::to_string( i ) )
+                    ( "postedAt", i % 3 == 0 ? fc::variant( stale ) : fc::variant() )
+                    ( "contentHash", fc::variant() )
+                    ( "region", fc::variant() ) );
+            }
+            base_tester::push_action( N(misblock), N(loadreviews), N(misblock), mvo()( "rows", rows ) );
+            produce_block();
+        }
+    }
+};
+
+}  // namespace mib_test
@@ -0,0 +1,302 @@
+#include <boost/test/unit_test.hpp>
+
+#include "misblock_tester.hpp"
+
+using namespace mib_test;
+
+namespace {
+
+// settlechan이 검증하는 voucher, 컨트랙트와 같은 순서로 필드를 이어붙인 digest에 서명
+//   sha256( pack( misblock, channelId, customer, hospital, nonce, amount ) )
+fc::crypto::signature signVoucher( const name& signer, uint64_t channelId, const name& customer, const name& hospital, uint64_t nonce, const asset& amount ) {
+   fc::sha256::encoder enc;
+   fc::raw::pack( enc, N(misblock).value );
+   fc::raw::pack( enc, channelId );
+   fc::raw::pack( enc, customer.value );
+   fc::raw::pack( enc, hospital.value );
+   fc::raw::pack( enc, nonce );
+   fc::raw::pack( enc, amount.get_amount() );
+   fc::raw::pack( enc, amount.get_symbol().value() );
+   return base_tester::get_private_key( signer, "active" ).sign( enc.result() );
+}
+
+// relaylikes가 검증하는 좋아요, sha256( pack( misblock, owner, reviewId, nonce ) )에 서명
+fc::variant likeIntent( const name& owner, uint64_t reviewId, uint64_t nonce, const name& signer ) {
+   fc::sha256::encoder enc;
+   fc::raw::pack( enc, N(misblock).value );
+   fc::raw::pack( enc, owner.value );
+   fc::raw::pack( enc, reviewId );
+   fc::raw::pack( enc, nonce );
+   return mvo()
+      ( "owner", owner )
+      ( "reviewId", reviewId )
+      ( "nonce", nonce )
+      ( "sig", base_tester::get_private_key( signer, "active" ).sign( enc.result() ) );
+}
+
+}  // namespace
+
+// 각 test case는 chain_snapshot_fixture가 저장한 상태를 자신의 임시 디렉토리에 복원해서 사용하므로 서로 독립적
+BOOST_AUTO_TEST_SUITE(misblock_tests)
+
+BOOST_FIXTURE_TEST_CASE( restored_state, misblock_tester ) try {
+   BOOST_REQUIRE( !getCustomer( N(alice) ).is_null() );
+   BOOST_REQUIRE( !getCustomer( N(bob) ).is_null() );
+
+   auto review = getReview( 1 );
+   BOOST_REQUIRE_EQUAL( "alice", review["owner"].as_string() );
+   BOOST_REQUIRE_EQUAL( "hospital1", review["hospital"].as_string() );
+   BOOST_REQUIRE_EQUAL( 1, review["likes"].as<int32_t>() );
+
+   auto hospital = getHospital( N(hospital1) );
+   BOOST_REQUIRE_EQUAL( 1, hospital["reviewCount"].as<uint32_t>() );
+   BOOST_REQUIRE_EQUAL( 1, hospital["totalReviewsLike"].as<uint32_t>() );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( postreview, misblock_tester ) try {
+   // alice는 이미 후기를 써서 자격을 사용했음
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "you must pay medical bills of that hospital through paymedical" ),
+      act( N(alice), N(postreview), mvo()
+         ( "owner", "alice" )
+         ( "hospital", "hospital1" )
+         ( "reviewId", 2 )
+         ( "title", "again" )
+         ( "reviewJson", "{}" ) ) );
+
+   // 같은 내용의 후기는 작성자가 달라도 거절
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "duplicate review" ),
+      act( N(bob), N(postreview), mvo()
+         ( "owner", "bob" )
+         ( "hospital", "hospital1" )
+         ( "reviewId", 2 )
+         ( "title", "kind doctors" )
+         ( "reviewJson", "{\"rating\":5}" ) ) );
+
+   BOOST_REQUIRE_EQUAL( success(),
+      act( N(bob), N(postreview), mvo()
+         ( "owner", "bob" )
+         ( "hospital", "hospital1" )
+         ( "reviewId", 2 )
+         ( "title", "short wait" )
+         ( "reviewJson", "{\"rating\":4}" ) ) );
+   produce_block();
+
+   BOOST_REQUIRE_EQUAL( "bob", getReview( 2 )["owner"].as_string() );
+   BOOST_REQUIRE_EQUAL( 2, getHospital( N(hospital1) )["reviewCount"].as<uint32_t>() );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( like, misblock_tester ) try {
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "you already like it" ),
+      act( N(bob), N(like), mvo()
+         ( "owner", "bob" )
+         ( "reviewId", 1 ) ) );
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "review does not exist" ),
+      act( N(alice), N(like), mvo()
+         ( "owner", "alice" )
+         ( "reviewId", 99 ) ) );
+
+   BOOST_REQUIRE_EQUAL( success(),
+      act( N(alice), N(like), mvo()
+         ( "owner", "alice" )
+         ( "reviewId", 1 ) ) );
+   produce_block();
+
+   BOOST_REQUIRE_EQUAL( 2, getReview( 1 )["likes"].as<int32_t>() );
+   BOOST_REQUIRE_EQUAL( 2, getHospital( N(hospital1) )["totalReviewsLike"].as<uint32_t>() );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( cashdeposit, misblock_tester ) try {
+   // hospital1은 populate에서 MIS를 받지 않았으므로 alice가 먼저 보내줌
+   BOOST_REQUIRE_EQUAL( success(), transfer( N(alice), N(hospital1), "100.0000 MIS", "" ) );
+   BOOST_REQUIRE_EQUAL( success(), transfer( N(hospital1), N(misblock), "30.0000 MIS", "depositcash" ) );
+   produce_block();
+   BOOST_REQUIRE_EQUAL( "30.0000 MIS", getCashDeposit( N(hospital1) )["balance"].as_string() );
+
+   // 병원 본인만 정산할 수 있음
+   BOOST_REQUIRE_EQUAL( error( "missing authority of hospital1" ),
+      act( N(alice), N(settlecash), mvo()
+         ( "hospital", "hospital1" )
+         ( "receipts", variants{ mvo()( "customer", "alice" )( "cost", "10.0000 MIS" )( "reviewId", UINT64_MAX ) } ) ) );
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "cash deposit is insufficient" ),
+      act( N(hospital1), N(settlecash), mvo()
+         ( "hospital", "hospital1" )
+         ( "receipts", variants{ mvo()( "customer", "alice" )( "cost", "31.0000 MIS" )( "reviewId", UINT64_MAX ) } ) ) );
+
+   // bob은 alice의 후기를 보고 방문
+   BOOST_REQUIRE_EQUAL( success(),
+      act( N(hospital1), N(settlecash), mvo()
+         ( "hospital", "hospital1" )
+         ( "receipts", variants{
+            mvo()( "customer", "alice" )( "cost", "10.0000 MIS" )( "reviewId", UINT64_MAX ),
+            mvo()( "customer", "bob" )( "cost", "10.0000 MIS" )( "reviewId", 1 ) } ) ) );
+   produce_block();
+   BOOST_REQUIRE_EQUAL( "10.0000 MIS", getCashDeposit( N(hospital1) )["balance"].as_string() );
+   BOOST_REQUIRE_EQUAL( 1, getHospital( N(hospital1) )["reviewVisitors"].as<uint32_t>() );
+
+   // 남은 잔액은 병원만 돌려받을 수 있고, 전액을 돌려받으면 row가 삭제됨
+   BOOST_REQUIRE_EQUAL( error( "missing authority of hospital1" ),
+      act( N(alice), N(withdrawcash), mvo()( "hospital", "hospital1" )( "quantity", "10.0000 MIS" ) ) );
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "cash deposit is insufficient" ),
+      act( N(hospital1), N(withdrawcash), mvo()( "hospital", "hospital1" )( "quantity", "10.0001 MIS" ) ) );
+
+   const asset before = getBalance( N(hospital1) );
+   BOOST_REQUIRE_EQUAL( success(),
+      act( N(hospital1), N(withdrawcash), mvo()( "hospital", "hospital1" )( "quantity", "4.0000 MIS" ) ) );
+   produce_block();
+   BOOST_REQUIRE_EQUAL( "6.0000 MIS", getCashDeposit( N(hospital1) )["balance"].as_string() );
+
+   // 정산으로 잔액이 정확히 0이 되어도 row가 삭제됨
+   BOOST_REQUIRE_EQUAL( success(),
+      act( N(hospital1), N(settlecash), mvo()
+         ( "hospital", "hospital1" )
+         ( "receipts", variants{ mvo()( "customer", "alice" )( "cost", "6.0000 MIS" )( "reviewId", UINT64_MAX ) } ) ) );
+   produce_block();
+   BOOST_REQUIRE( getCashDeposit( N(hospital1) ).is_null() );
+   BOOST_REQUIRE_EQUAL( before + asset::from_string( "4.0000 MIS" ), getBalance( N(hospital1) ) );
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "no cash deposit" ),
+      act( N(hospital1), N(withdrawcash), mvo()( "hospital", "hospital1" )( "quantity", "1.0000 MIS" ) ) );
+
+   // 다시 입금한 후 전액 인출
+   BOOST_REQUIRE_EQUAL( success(), transfer( N(hospital1), N(misblock), "5.0000 MIS", "depositcash" ) );
+   BOOST_REQUIRE_EQUAL( success(),
+      act( N(hospital1), N(withdrawcash), mvo()( "hospital", "hospital1" )( "quantity", "5.0000 MIS" ) ) );
+   produce_block();
+   BOOST_REQUIRE( getCashDeposit( N(hospital1) ).is_null() );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( channel_settle, misblock_tester ) try {
+   const auto aliceKey = get_public_key( N(alice), "active" );
+   BOOST_REQUIRE_EQUAL( success(),
+      act( N(alice), N(openchannel), mvo()
+         ( "customer", "alice" )( "hospital", "hospital1" )( "channelId", 7 )( "customerKey", aliceKey )( "timeout", 600 ) ) );
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "channelId already exist" ),
+      act( N(alice), N(openchannel), mvo()
+         ( "customer", "alice" )( "hospital", "hospital1" )( "channelId", 7 )( "customerKey", aliceKey )( "timeout", 600 ) ) );
+   BOOST_REQUIRE_EQUAL( success(), transfer( N(alice), N(misblock), "50.0000 MIS", "payconsmis:7" ) );
+   produce_block();
+
+   auto channel = getRow( N(channels), "ChannelInfo", 7 );
+   BOOST_REQUIRE_EQUAL( "50.0000 MIS", channel["deposit"].as_string() );
+   const uint64_t nonce = channel["nonce"].as_uint64();
+
+   const asset amount = asset::from_string( "20.0000 MIS" );
+   const auto voucher = signVoucher( N(alice), 7, N(alice), N(hospital1), nonce, amount );
+
+   // 예치금보다 큰 voucher, 다른 키로 서명한 voucher, 금액을 바꾼 voucher
+   const asset over = asset::from_string( "50.0001 MIS" );
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "voucher exceeds deposit" ),
+      act( N(hospital1), N(settlechan), mvo()
+         ( "hospital", "hospital1" )( "channelId", 7 )( "amount", over )( "sig", signVoucher( N(alice), 7, N(alice), N(hospital1), nonce, over ) ) ) );
+   BOOST_REQUIRE_EQUAL( error( "Error expected key different than recovered key" ),
+      act( N(hospital1), N(settlechan), mvo()
+         ( "hospital", "hospital1" )( "channelId", 7 )( "amount", amount )( "sig", signVoucher( N(bob), 7, N(alice), N(hospital1), nonce, amount ) ) ) );
+   BOOST_REQUIRE_EQUAL( error( "Error expected key different than recovered key" ),
+      act( N(hospital1), N(settlechan), mvo()
+         ( "hospital", "hospital1" )( "channelId", 7 )( "amount", "30.0000 MIS" )( "sig", voucher ) ) );
+   BOOST_REQUIRE_EQUAL( error( "missing authority of hospital1" ),
+      act( N(alice), N(settlechan), mvo()
+         ( "hospital", "hospital1" )( "channelId", 7 )( "amount", amount )( "sig", voucher ) ) );
+
+   const asset hospitalBefore = getBalance( N(hospital1) );
+   const asset aliceBefore = getBalance( N(alice) );
+   BOOST_REQUIRE_EQUAL( success(),
+      act( N(hospital1), N(settlechan), mvo()
+         ( "hospital", "hospital1" )( "channelId", 7 )( "amount", amount )( "sig", voucher ) ) );
+   produce_block();
+
+   BOOST_REQUIRE( getRow( N(channels), "ChannelInfo", 7 ).is_null() );
+   BOOST_REQUIRE_EQUAL( hospitalBefore + amount, getBalance( N(hospital1) ) );
+   BOOST_REQUIRE_EQUAL( aliceBefore + asset::from_string( "30.0000 MIS" ), getBalance( N(alice) ) );
+
+   // 같은 id로 다시 연 채널에는 이전 nonce의 voucher를 다시 쓸 수 없음
+   BOOST_REQUIRE_EQUAL( success(),
+      act( N(alice), N(openchannel), mvo()
+         ( "customer", "alice" )( "hospital", "hospital1" )( "channelId", 7 )( "customerKey", aliceKey )( "timeout", 600 ) ) );
+   BOOST_REQUIRE_EQUAL( success(), transfer( N(alice), N(misblock), "50.0000 MIS", "payconsmis:7" ) );
+   produce_block();
+   BOOST_REQUIRE( nonce != getRow( N(channels), "ChannelInfo", 7 )["nonce"].as_uint64() );
+   BOOST_REQUIRE_EQUAL( error( "Error expected key different than recovered key" ),
+      act( N(hospital1), N(settlechan), mvo()
+         ( "hospital", "hospital1" )( "channelId", 7 )( "amount", amount )( "sig", voucher ) ) );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( channel_refund, misblock_tester ) try {
+   BOOST_REQUIRE_EQUAL( success(),
+      act( N(bob), N(openchannel), mvo()
+         ( "customer", "bob" )( "hospital", "hospital1" )( "channelId", 8 )( "customerKey", get_public_key( N(bob), "active" ) )( "timeout", 600 ) ) );
+   BOOST_REQUIRE_EQUAL( success(), transfer( N(bob), N(misblock), "40.0000 MIS", "payconsmis:8" ) );
+   produce_block();
+
+   const asset bobBefore = getBalance( N(bob) );
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "channel is not expired" ),
+      act( N(bob), N(refundchan), mvo()( "customer", "bob" )( "channelId", 8 ) ) );
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "invalid channel" ),
+      act( N(alice), N(refundchan), mvo()( "customer", "alice" )( "channelId", 8 ) ) );
+
+   produce_block( fc::seconds( 600 ) );
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "channel is expired" ), transfer( N(bob), N(misblock), "1.0000 MIS", "payconsmis:8" ) );
+   BOOST_REQUIRE_EQUAL( success(),
+      act( N(bob), N(refundchan), mvo()( "customer", "bob" )( "channelId", 8 ) ) );
+   produce_block();
+
+   BOOST_REQUIRE( getRow( N(channels), "ChannelInfo", 8 ).is_null() );
+   BOOST_REQUIRE_EQUAL( bobBefore + asset::from_string( "40.0000 MIS" ), getBalance( N(bob) ) );
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "channel does not exist" ),
+      act( N(bob), N(refundchan), mvo()( "customer", "bob" )( "channelId", 8 ) ) );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( relaylikes, misblock_tester ) try {
+   // bob이 남은 자격으로 후기 2를 작성, alice의 좋아요를 bob이 대신 제출
+   BOOST_REQUIRE_EQUAL( success(),
+      act( N(bob), N(postreview), mvo()
+         ( "owner", "bob" )
+         ( "hospital", "hospital1" )
+         ( "reviewId", 2 )
+         ( "title", "short wait" )
+         ( "reviewJson", "{\"rating\":4}" ) ) );
+   BOOST_REQUIRE_EQUAL( success(),
+      act( N(alice), N(setlikekey), mvo()( "owner", "alice" )( "likeKey", get_public_key( N(alice), "active" ) ) ) );
+   produce_block();
+
+   auto relay = [&]( const fc::variants& likes ) {
+      auto result = act( N(bob), N(relaylikes), mvo()( "relayer", "bob" )( "likes", likes ) );
+      produce_block();
+      return result;
+   };
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "bob has no like key" ), relay( { likeIntent( N(bob), 1, 1, N(bob) ) } ) );
+
+   // 다른 키로 서명했거나 서명한 후기와 다른 후기
+   BOOST_REQUIRE_EQUAL( error( "Error expected key different than recovered key" ), relay( { likeIntent( N(alice), 2, 1, N(bob) ) } ) );
+   auto moved = likeIntent( N(alice), 2, 1, N(alice) ).get_object();
+   BOOST_REQUIRE_EQUAL( error( "Error expected key different than recovered key" ),
+      relay( { mvo( moved )( "reviewId", 1 ) } ) );
+
+   // 하루(TEST 빌드에서는 1분) 좋아요 3개를 넘는 묶음
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "there are no remaining likes" ),
+      relay( { likeIntent( N(alice), 2, 1, N(alice) ), likeIntent( N(alice), 2, 2, N(alice) ),
+               likeIntent( N(alice), 2, 3, N(alice) ), likeIntent( N(alice), 2, 4, N(alice) ) } ) );
+
+   // 한 묶음에 같은 후기를 두 번
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "you already like it" ),
+      relay( { likeIntent( N(alice), 2, 1, N(alice) ), likeIntent( N(alice), 2, 2, N(alice) ) } ) );
+
+   // 한 묶음 안에서도 nonce는 증가해야 함
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "nonce must increase" ),
+      relay( { likeIntent( N(alice), 2, 2, N(alice) ), likeIntent( N(alice), 2, 2, N(alice) ) } ) );
+
+   // 실패한 묶음은 nonce를 소비하지 않음
+   const auto accepted = likeIntent( N(alice), 2, 1, N(alice) );
+   BOOST_REQUIRE_EQUAL( success(), relay( { accepted } ) );
+   BOOST_REQUIRE_EQUAL( 1, getReview( 2 )["likes"].as<int32_t>() );
+   BOOST_REQUIRE_EQUAL( 1, getRow( N(relaykeys), "RelayKeyInfo", N(alice).value )["nonce"].as_uint64() );
+
+   // 같은 좋아요를 다시 제출
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "nonce must increase" ), relay( { accepted } ) );
+   BOOST_REQUIRE_EQUAL( 1, getReview( 2 )["likes"].as<int32_t>() );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,230 @@
+#include <boost/test/unit_test.hpp>
+
+#include "misblock_tester.hpp"
+
+using namespace mib_test;
+
+namespace {
+
+// 기본 지역에 순위 대상 병원 17개를 추가한 상태
+//   ranka..ranko: EMR 판매 수 100..86, rankp/rankq: 85로 같음 (owner 순서로 rankp가 앞)
+//   hospitalThreshold 95 이상은 ranka..rankf 6개, 후기는 좋아요 100개 이상인 것이 없음
+//   rankworker가 제출, challenge 기간은 기본값 (TEST 빌드에서 15초)
+class rank_tester : public misblock_tester {
+public:
+   rank_tester() {
+      vector<account_name> hospitals;
+      for ( char c = 'a'; c <= 'q'; ++c ) {
+         hospitals.emplace_back( string( "rank" ) + c );
+      }
+      create_accounts( hospitals );
+      create_accounts( { N(rankworker) } );
+      produce_block();
+
+      // 16개 병원에 1000000 MIS씩 지급할 수 있도록 충전
+      base_tester::push_action( N(led.token), N(issue), N(led.token), mvo()
+         ( "to", "led.token" )
+         ( "quantity", "20000000.0000 MIS" )
+         ( "memo", "" ) );
+      BOOST_REQUIRE_EQUAL( success(), transfer( N(led.token), N(misblock), "20000000.0000 MIS", "" ) );
+
+      fc::variants sales;
+      for ( size_t i = 0; i < hospitals.size(); ++i ) {
+         BOOST_REQUIRE_EQUAL( success(), act( N(misblock), N(reghospital), mvo()
+            ( "owner", hospitals[i] )
+            ( "url", "https://" + hospitals[i].to_string() + ".example" )
+            ( "region", "" ) ) );
+         sales.push_back( mvo()( "hospital", hospitals[i] )( "sales", i < 15 ? 100 - i : 85 ) );
+      }
+      produce_block();
+
+      BOOST_REQUIRE_EQUAL( success(), act( N(misblock), N(setemrrptr), mvo()( "emrReporter", "misblock" ) ) );
+      BOOST_REQUIRE_EQUAL( success(), act( N(misblock), N(addemrsales), mvo()
+         ( "windowStart", today() )
+         ( "sales", sales ) ) );
+      BOOST_REQUIRE_EQUAL( success(), act( N(misblock), N(setrankcfg), mvo()
+         ( "rankWorker", "rankworker" )
+         ( "rankChallengeWindow", 15 )
+         ( "hospitalThreshold", 95 )
+         ( "reviewThreshold", 100 ) ) );
+      produce_block();
+
+      BOOST_REQUIRE_EQUAL( 100, weightOf( "ranka" ) );
+      BOOST_REQUIRE_EQUAL( 86, weightOf( "ranko" ) );
+      BOOST_REQUIRE_EQUAL( 85, weightOf( "rankp" ) );
+      BOOST_REQUIRE_EQUAL( 85, weightOf( "rankq" ) );
+   }
+
+   uint64_t today() {
+      const uint64_t now = control->head_block_time().sec_since_epoch();
+      return now - now % ( 24 * 3600 );
+   }
+
+   double weightOf( const string& hospital ) {
+      return getHospital( name( hospital ) )["serviceWeight"].as<double>();
+   }
+
+   // first..last 범위의 병원 중 skip을 뺀 목록
+   fc::variants ranked( char first, char last, const string& skip = "" ) {
+      fc::variants hospitals;
+      for ( char c = first; c <= last; ++c ) {
+         if ( skip.find( c ) == string::npos ) hospitals.emplace_back( string( "rank" ) + c );
+      }
+      return hospitals;
+   }
+
+   action_result propose( const fc::variants& hospitals ) {
+      auto result = act( N(rankworker), N(proposerank), mvo()
+         ( "hospitals", hospitals )
+         ( "reviews", fc::variants() ) );
+      produce_block();
+      return result;
+   }
+
+   action_result challenge( const string& hospital ) {
+      auto result = act( N(alice), N(challenge), mvo()
+         ( "challenger", "alice" )
+         ( "key", name( hospital ).value )
+         ( "isReview", false ) );
+      produce_block();
+      return result;
+   }
+
+   action_result finalize() {
+      auto result = act( N(alice), N(finalrank), mvo() );
+      produce_block();
+      return result;
+   }
+
+   bool hasProposal() {
+      return !getRow( N(rankprop), "RankProposal", N(rankprop).value ).is_null();
+   }
+};
+
+}  // namespace
+
+// 순위 제출(proposerank)과 challenge/finalrank/cancelrank
+BOOST_AUTO_TEST_SUITE(rank_tests)
+
+BOOST_FIXTURE_TEST_CASE( finalize_valid_proposal, rank_tester ) try {
+   produceToNextPeriod();
+   BOOST_REQUIRE_EQUAL( success(), propose( ranked( 'a', 'p' ) ) );
+   BOOST_REQUIRE( hasProposal() );
+
+   // 제출 후에 올린 weight로는 challenge 할 수 없음
+   BOOST_REQUIRE_EQUAL( success(), act( N(misblock), N(addemrsales), mvo()
+      ( "windowStart", today() - 24 * 3600 )
+      ( "sales", fc::variants{ mvo()( "hospital", "rankq" )( "sales", 10 ) } ) ) );
+   produce_block();
+   BOOST_REQUIRE_EQUAL( 95, weightOf( "rankq" ) );
+
+   // rankq는 제출 시점에 rankp와 weight가 같고 owner 순서로 뒤
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "ranking proposal is valid" ), challenge( "rankq" ) );
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "hospital is already ranked" ), challenge( "ranka" ) );
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "challenge window is still open" ), finalize() );
+
+   const asset before = getBalance( N(ranka) );
+   produce_block( fc::seconds( 15 ) );
+   BOOST_REQUIRE_EQUAL( success(), finalize() );
+   BOOST_REQUIRE( !hasProposal() );
+
+   BOOST_REQUIRE_EQUAL( before + asset::from_string( "1000000.0000 MIS" ), getBalance( N(ranka) ) );
+   BOOST_REQUIRE_EQUAL( 0, getHospital( N(ranka) )["emrSales"].as<uint32_t>() );
+   BOOST_REQUIRE_EQUAL( 95, weightOf( "rankq" ) );
+
+   // 같은 보상 기간에는 다시 제출할 수 없음
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "already gave rewards within this minute(test)" ), propose( ranked( 'b', 'q' ) ) );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( reject_invalid_proposal, rank_tester ) try {
+   produceToNextPeriod();
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "hospitals are not strictly ordered" ),
+      propose( fc::variants{ fc::variant( "rankb" ), fc::variant( "ranka" ) } ) );
+   // rankq는 weight가 같은 rankp보다 owner가 뒤
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "hospitals are not strictly ordered" ),
+      propose( fc::variants{ fc::variant( "rankq" ), fc::variant( "rankp" ) } ) );
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "hospitals above threshold are missing" ), propose( ranked( 'a', 'f', "c" ) ) );
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "at most 16 entries" ), propose( ranked( 'a', 'q' ) ) );
+   BOOST_REQUIRE_EQUAL( error( "missing authority of rankworker" ),
+      act( N(alice), N(proposerank), mvo()( "hospitals", ranked( 'a', 'p' ) )( "reviews", fc::variants() ) ) );
+
+   // challenge가 끝나기 전에 보상 기간이 바뀌는 제출
+   produce_block( fc::seconds( 50 ) );
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "challenge window would end after this rewards period" ), propose( ranked( 'a', 'p' ) ) );
+   BOOST_REQUIRE( !hasProposal() );
+
+   // 보상 기간의 절반을 넘는 challenge 기간은 설정할 수 없음
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "challenge window must be within half of the rewards period" ),
+      act( N(misblock), N(setrankcfg), mvo()
+         ( "rankWorker", "rankworker" )
+         ( "rankChallengeWindow", rewardsPeriodSeconds / 2 + 1 )
+         ( "hospitalThreshold", 95 )
+         ( "reviewThreshold", 100 ) ) );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( challenge_ordering, rank_tester ) try {
+   // 16개를 채웠지만 rankh(93)를 빼고 마지막이 rankq(85)
+   produceToNextPeriod();
+   BOOST_REQUIRE_EQUAL( success(), propose( ranked( 'a', 'q', "h" ) ) );
+   BOOST_REQUIRE_EQUAL( success(), challenge( "rankh" ) );
+   BOOST_REQUIRE( !hasProposal() );
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "no ranking proposal" ), finalize() );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( challenge_below_threshold, rank_tester ) try {
+   // threshold 이상인 병원만 제출하면 proposerank는 통과하지만, 16개가 안 되므로 빠진 병원은 모두 challenge 대상
+   produceToNextPeriod();
+   BOOST_REQUIRE_EQUAL( success(), propose( ranked( 'a', 'f' ) ) );
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "hospital does not exist" ), challenge( "nobody" ) );
+   BOOST_REQUIRE_EQUAL( success(), challenge( "rankg" ) );
+   BOOST_REQUIRE( !hasProposal() );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( challenge_missing_entry, rank_tester ) try {
+   // rankp가 빠지고 weight가 같은 rankq가 마지막, owner 순서로는 rankp가 앞
+   produceToNextPeriod();
+   BOOST_REQUIRE_EQUAL( success(), propose( ranked( 'a', 'q', "p" ) ) );
+   BOOST_REQUIRE_EQUAL( success(), challenge( "rankp" ) );
+   BOOST_REQUIRE( !hasProposal() );
+
+   // challenge로 폐기된 후에는 같은 기간에 다시 제출할 수 있음
+   BOOST_REQUIRE_EQUAL( success(), propose( ranked( 'a', 'p' ) ) );
+   BOOST_REQUIRE( hasProposal() );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( stale_period, rank_tester ) try {
+   produceToNextPeriod();
+   BOOST_REQUIRE_EQUAL( success(), propose( ranked( 'a', 'p' ) ) );
+
+   // challenge 기간이 끝난 후 보상 기간이 바뀔 때까지 finalrank를 부르지 않으면 지급하지 않고 폐기
+   const asset before = getBalance( N(ranka) );
+   produceToNextPeriod();
+   BOOST_REQUIRE_EQUAL( success(), finalize() );
+   BOOST_REQUIRE( !hasProposal() );
+   BOOST_REQUIRE_EQUAL( before, getBalance( N(ranka) ) );
+   BOOST_REQUIRE_EQUAL( 100, weightOf( "ranka" ) );
+
+   // 지급하지 않았으므로 새 기간에 다시 제출할 수 있음
+   BOOST_REQUIRE_EQUAL( success(), propose( ranked( 'a', 'p' ) ) );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( cancelrank, rank_tester ) try {
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "no ranking proposal" ), act( N(misblock), N(cancelrank), mvo() ) );
+
+   produceToNextPeriod();
+   BOOST_REQUIRE_EQUAL( success(), propose( ranked( 'a', 'p' ) ) );
+   BOOST_REQUIRE_EQUAL( error( "missing authority of misblock" ), act( N(alice), N(cancelrank), mvo() ) );
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "ranking proposal is pending" ),
+      act( N(misblock), N(setrankcfg), mvo()
+         ( "rankWorker", "rankworker" )
+         ( "rankChallengeWindow", 15 )
+         ( "hospitalThreshold", 90 )
+         ( "reviewThreshold", 100 ) ) );
+
+   BOOST_REQUIRE_EQUAL( success(), act( N(misblock), N(cancelrank), mvo() ) );
+   produce_block();
+   BOOST_REQUIRE( !hasProposal() );
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "no ranking proposal" ), finalize() );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()